@@ -5,7 +5,8 @@ import json
 
 PUBLIC_MACROS = (
     (
-        "RELLUME_PUBLIC_REG", lambda e: "reg" in e and e.get("export"),
+        "RELLUME_PUBLIC_REG",
+        lambda e: ("reg" in e or "alias_of" in e) and e.get("export"),
         "RELLUME_PUBLIC_REG({name}, {NAME}, {size}, {offset})",
     ),
 )
@@ -37,6 +38,22 @@ if __name__ == "__main__":
         if "name" in entry:
             entry["NAME"] = entry["name"].upper()
         off += entry["size"]
+    struct_size = off
+
+    # Aliases name the lower part of an entry, e.g. xmm0 for ymm0. They occupy
+    # no space of their own and are not mapped to a register.
+    aliased = []
+    for entry in desc:
+        aliased.append(entry)
+        for alias in entry.get("aliases", []):
+            if alias["size"] > entry["size"]:
+                raise Exception("alias larger than entry {}".format(entry))
+            aliased.append({
+                "name": alias["name"], "NAME": alias["name"].upper(),
+                "size": alias["size"], "offset": entry["offset"],
+                "export": entry.get("export"), "alias_of": entry["name"],
+            })
+    desc = aliased
 
     macros = PUBLIC_MACROS if not args.private else PRIVATE_MACROS
 
@@ -46,5 +63,8 @@ if __name__ == "__main__":
         for entry in (e for e in desc if include(e)):
             res += fmt.format(**entry) + "\n"
         res += "#endif\n"
+    res += "#ifdef RELLUME_CPU_STRUCT_SIZE\n"
+    res += "RELLUME_CPU_STRUCT_SIZE({})\n".format(struct_size)
+    res += "#endif\n"
 
     args.output.write(res)
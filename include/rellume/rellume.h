@@ -37,6 +37,11 @@ extern "C" {
 #define RELLUME_API __attribute__((visibility("default")))
 #define RELLUME_DEPRECATED __attribute__((deprecated))
 
+/// Version of the CPU struct layouts in rellume/cpustruct-*.inc, incremented
+/// on incompatible changes. Version 2 widened the x86-64 vector registers to
+/// 32 bytes (ymm0-15), which moved the offsets of xmm1-15.
+#define RELLUME_CPU_STRUCT_VERSION 2
+
 
 typedef struct LLConfig LLConfig;
 
@@ -48,6 +53,11 @@ RELLUME_API void ll_config_enable_overflow_intrinsics(LLConfig*, bool);
 RELLUME_API void ll_config_enable_fast_math(LLConfig*, bool);
 RELLUME_API void ll_config_enable_verify_ir(LLConfig*, bool);
 RELLUME_API void ll_config_set_position_independent_code(LLConfig*, bool);
+/// Keep stack slots of the lifted function in an alloca instead of guest
+/// memory, if all stack accesses have constant offsets and the stack pointer
+/// does not escape. The frame is written back to memory at exits where it may
+/// still be live. Off by default.
+RELLUME_API void ll_config_enable_stack_promotion(LLConfig*, bool);
 RELLUME_API void ll_config_set_pc_base(LLConfig*, uintptr_t, LLVMValueRef);
 RELLUME_API void ll_config_set_global_base(LLConfig*, uintptr_t, LLVMValueRef);
 RELLUME_API void ll_config_set_instr_impl(LLConfig*, unsigned,
@@ -58,7 +68,19 @@ RELLUME_API void ll_config_set_syscall_impl(LLConfig*, LLVMValueRef);
 RELLUME_API void ll_config_set_cpuinfo_func(LLConfig*, LLVMValueRef);
 RELLUME_API void ll_config_set_instr_marker(LLConfig*, LLVMValueRef);
 RELLUME_API void ll_config_set_call_ret_clobber_flags(LLConfig*, bool);
+/// Assume that functions called through call_func follow the platform ABI and
+/// preserve callee-saved registers and the stack pointer, which are then not
+/// reloaded after the call. Off by default.
+RELLUME_API void ll_config_set_call_preserve_callee_saved(LLConfig*, bool);
 RELLUME_API void ll_config_set_use_native_segment_base(LLConfig*, bool);
+/// Lift PDEP and PEXT to the x86 BMI2 intrinsics instead of a generic loop.
+/// Only use this if the lifted code runs on an x86 host with BMI2. Off by
+/// default.
+RELLUME_API void ll_config_set_use_native_bmi2(LLConfig*, bool);
+/// Lift CRC32, AES-NI and PCLMULQDQ to the x86 intrinsics instead of generic
+/// IR. Only use this if the lifted code runs on an x86 host with SSE4.2, AES
+/// and PCLMUL. Off by default.
+RELLUME_API void ll_config_set_use_native_crypto(LLConfig*, bool);
 RELLUME_API void ll_config_enable_full_facets(LLConfig*, bool) RELLUME_DEPRECATED;
 
 /// Sets the architecture. Currently the only valid options is "x86_64", which
@@ -68,6 +90,38 @@ RELLUME_API void ll_config_enable_full_facets(LLConfig*, bool) RELLUME_DEPRECATE
 /// without support for x86-64, th behavior of ll_func_new is undefined.
 /// For backwards compatibility, also "x86-64" is accepted as valid option.
 RELLUME_API bool ll_config_set_architecture(LLConfig*, const char*);
+/// Use a calling convention for the lifted function that passes the PC and the
+/// most frequently used general purpose registers as arguments and returns
+/// them as aggregate; all other registers remain in the CPU struct. Tail and
+/// call functions with a non-void return type are called with this convention
+/// as well. Must be called after setting the architecture. Returns false if the
+/// architecture has no such convention.
+RELLUME_API bool ll_config_set_register_callconv(LLConfig*, bool);
+
+/// Read code through the memory access callback in chunks of page_size bytes,
+/// which must be a power of two, and cache these for the lifetime of the
+/// function. This is useful if the callback is expensive, e.g. when reading
+/// memory of another process. The cached pages are assumed to not change.
+/// A value of zero (default) reads every instruction separately.
+RELLUME_API void ll_config_set_decode_page_size(LLConfig*, size_t page_size);
+/// Limit decoding of a function to a maximum number of instructions, basic
+/// blocks, and distance between the lowest and highest code address. Zero
+/// disables a limit. When a limit is reached, decoding stops and branches to
+/// code which was not decoded leave the lifted function, see ll_func_is_partial.
+RELLUME_API void ll_config_set_decode_budget(LLConfig*, size_t max_instrs,
+                                             size_t max_blocks,
+                                             uint64_t max_span);
+/// Share decoded instructions with other functions through a process-wide
+/// cache. Cached instructions are only used if the code bytes are unchanged.
+RELLUME_API void ll_config_enable_instr_cache(LLConfig*, bool);
+/// Register fn, which must be in the module of the lifted code, as lifted
+/// function for the code at addr. Direct calls (with a call function set) and
+/// branches to addr call fn directly. If fn is a declaration, lifting a
+/// function at addr lifts into fn.
+RELLUME_API void ll_config_set_lifted_func(LLConfig*, uintptr_t addr,
+                                           LLVMValueRef fn);
+/// Get the function registered for addr, or NULL.
+RELLUME_API LLVMValueRef ll_config_get_lifted_func(LLConfig*, uintptr_t addr);
 
 typedef struct LLFunc LLFunc;
 
@@ -83,6 +137,85 @@ RELLUME_API int ll_func_decode_block(LLFunc* func, uintptr_t addr,
                                      RellumeMemAccessCb cb, void* user_arg);
 RELLUME_API int ll_func_decode_cfg(LLFunc* func, uintptr_t addr,
                                    RellumeMemAccessCb cb, void* user_arg);
+/// Decode further code starting at addr after the function was decoded and
+/// possibly lifted, when addr was found to be the target of the indirect branch
+/// at branch_addr at run-time. Previously decoded instructions are reused. If
+/// the branch cannot be resolved while lifting, it continues at addr, other
+/// targets still leave the function; other branches are unaffected. Only
+/// decoding is incremental: a subsequent ll_func_lift lifts all decoded
+/// instructions again into a new function and leaves previously lifted
+/// functions unmodified. Returns -1 if branch_addr was not decoded.
+RELLUME_API int ll_func_decode_more(LLFunc* func, uintptr_t branch_addr,
+                                    uintptr_t addr, RellumeMemAccessCb cb,
+                                    void* user_arg);
+
+/// Decode from a caller-provided buffer which contains the code mapped at
+/// base_addr, without invoking a callback per instruction. Code outside of the
+/// buffer is treated as not decodable. The buffer must remain valid until
+/// decoding is completed. Returns non-zero if addr is outside of the buffer.
+RELLUME_API int ll_func_decode_instr_span(LLFunc* func, uintptr_t base_addr,
+                                          const uint8_t* buf, size_t len,
+                                          uintptr_t addr);
+RELLUME_API int ll_func_decode_block_span(LLFunc* func, uintptr_t base_addr,
+                                          const uint8_t* buf, size_t len,
+                                          uintptr_t addr);
+RELLUME_API int ll_func_decode_cfg_span(LLFunc* func, uintptr_t base_addr,
+                                        const uint8_t* buf, size_t len,
+                                        uintptr_t addr);
+
+/// Called once per worker of ll_batch_lift with the worker's copy of the
+/// configuration and its module before lifting any function. This is the place
+/// to set configuration options which refer to LLVM values (e.g. the tail
+/// function), which must be declared in the worker's module.
+typedef void(* RellumeBatchInitCb)(LLConfig* cfg, LLVMModuleRef mod,
+                                   void* user_arg);
+/// Called once per worker of ll_batch_lift after all its functions are lifted.
+/// fns[i] is the lifted function for entries[i], or NULL if lifting failed.
+/// The module and its context are destroyed after the callback returns.
+typedef void(* RellumeBatchDoneCb)(LLVMModuleRef mod, const uintptr_t* entries,
+                                   const LLVMValueRef* fns, size_t count,
+                                   void* user_arg);
+/// Decode and lift the functions at entries concurrently with nthreads worker
+/// threads (zero uses all available cores); the calling thread is one of these.
+/// Each worker uses a separate LLVMContext and module.
+///
+/// The configuration is shared read-only between workers and each worker works
+/// on a copy of it. Therefore, it must not contain any LLVM values (global and
+/// PC base values, instruction implementations, tail, call, syscall, cpuinfo,
+/// marker, and lifted functions); these must be set by init_cb instead. The callbacks
+/// mem_acc, init_cb, and done_cb are called concurrently from multiple threads.
+/// Returns non-zero if the configuration is not suitable for batch lifting.
+RELLUME_API int ll_batch_lift(const uintptr_t* entries, size_t count,
+                              const LLConfig* cfg, unsigned nthreads,
+                              RellumeMemAccessCb mem_acc,
+                              RellumeBatchInitCb init_cb,
+                              RellumeBatchDoneCb done_cb, void* user_arg);
+
+/// Decode and lift the function at root and all functions reachable through
+/// direct calls into mod. All lifted functions are registered in the
+/// configuration and call each other directly; functions registered before
+/// are not lifted again. Returns the function for root, or NULL if any
+/// function failed to lift; these remain declarations.
+RELLUME_API LLVMValueRef ll_lift_call_graph(LLVMModuleRef mod, LLConfig*,
+                                            uintptr_t root,
+                                            RellumeMemAccessCb cb,
+                                            void* user_arg);
+
+/// Declare [start, end) as read-only memory, whose contents do not change while
+/// the lifted code runs. Loads from constant addresses in such ranges are
+/// replaced by the value at lift time, read through the callback set with
+/// ll_config_set_ro_mem_reader or directly from memory.
+RELLUME_API void ll_config_add_ro_range(LLConfig*, uintptr_t start,
+                                        uintptr_t end);
+RELLUME_API void ll_config_set_ro_mem_reader(LLConfig*, RellumeMemAccessCb cb,
+                                             void* user_arg);
+
+/// Remove all instructions starting in [start, end) from the process-wide
+/// instruction cache, e.g. after the code was unmapped.
+RELLUME_API void ll_instr_cache_invalidate(uintptr_t start, uintptr_t end);
+
+/// Returns whether decoding stopped early because of the decode budget.
+RELLUME_API bool ll_func_is_partial(LLFunc* func);
 
 struct RellumeCodeRange {
     uint64_t start, end;
@@ -962,6 +962,7 @@ void Lifter::FlagCalcSub(llvm::Value* res, llvm::Value* lhs, llvm::Value* rhs) {
     SetReg(ArchReg::SF, sf);
     SetReg(ArchReg::CF, irb.CreateICmpUGE(lhs, rhs));
     SetReg(ArchReg::OF, irb.CreateICmpNE(sf, irb.CreateICmpSLT(lhs, rhs)));
+    regfile->SetFlagCmp(lhs, rhs);
 }
 
 void Lifter::FlagCalcLogic(llvm::Value* res) {
@@ -1084,6 +1085,26 @@ llvm::Type* Lifter::TypeOf(farmdec::FPSize fsz) {
 // Returns a i1 that is 1 if the A64 condition is true, 0 otherwise.
 // Look into any intro of the A64 instruction set for reference.
 llvm::Value* Lifter::IsTrue(farmdec::Cond cond) {
+    // If the flags come from a comparison, use a single integer comparison.
+    if (auto [lhs, rhs] = regfile->GetFlagCmp(); lhs) {
+        auto pred = llvm::CmpInst::BAD_ICMP_PREDICATE;
+        switch (cond) {
+        case farmdec::COND_EQ: pred = llvm::CmpInst::ICMP_EQ; break;
+        case farmdec::COND_NE: pred = llvm::CmpInst::ICMP_NE; break;
+        case farmdec::COND_HS: pred = llvm::CmpInst::ICMP_UGE; break;
+        case farmdec::COND_LO: pred = llvm::CmpInst::ICMP_ULT; break;
+        case farmdec::COND_HI: pred = llvm::CmpInst::ICMP_UGT; break;
+        case farmdec::COND_LS: pred = llvm::CmpInst::ICMP_ULE; break;
+        case farmdec::COND_GE: pred = llvm::CmpInst::ICMP_SGE; break;
+        case farmdec::COND_LT: pred = llvm::CmpInst::ICMP_SLT; break;
+        case farmdec::COND_GT: pred = llvm::CmpInst::ICMP_SGT; break;
+        case farmdec::COND_LE: pred = llvm::CmpInst::ICMP_SLE; break;
+        default: break; // MI, PL, VS, VC need the flag values
+        }
+        if (pred != llvm::CmpInst::BAD_ICMP_PREDICATE)
+            return irb.CreateICmp(pred, lhs, rhs);
+    }
+
     llvm::Value* res = nullptr; // positive result, inverted iff LSB(cond) == 1
     switch (cond) {
     case farmdec::COND_EQ: case farmdec::COND_NE: res = GetFlag(ArchReg::ZF); break;
@@ -1306,24 +1327,32 @@ void Lifter::LiftCCmp(llvm::Value* lhs, llvm::Value* rhs, farmdec::Cond cond, ui
 void Lifter::Load(farmdec::Reg rt, bool w32, llvm::Type* srcty,
                   llvm::Value* ptr, farmdec::ExtendType ext,
                   farmdec::MemOrdering mo) {
-    llvm::LoadInst* load = irb.CreateAlignedLoad(srcty, ptr, llvm::Align(1));
-    if (mo != farmdec::MO_NONE) {
-        load->setOrdering(Ordering(mo));
-        load->setAlignment(llvm::Align(srcty->getPrimitiveSizeInBits() / 8));
+    llvm::Value* val = mo == farmdec::MO_NONE ? LoadReadOnly(srcty, ptr) : nullptr;
+    if (!val) {
+        llvm::LoadInst* load = irb.CreateAlignedLoad(srcty, ptr, llvm::Align(1));
+        if (mo != farmdec::MO_NONE) {
+            load->setOrdering(Ordering(mo));
+            load->setAlignment(llvm::Align(srcty->getPrimitiveSizeInBits() / 8));
+        }
+        val = load;
     }
 
-    SetGp(rt, w32, Extend(load, w32, ext, 0));
+    SetGp(rt, w32, Extend(val, w32, ext, 0));
 }
 
 // Loads into the SIMD&FP register Vt.
 void Lifter::Load(farmdec::Reg rt, llvm::Type* srcty, llvm::Value* ptr, farmdec::MemOrdering mo) {
-    llvm::LoadInst* load = irb.CreateAlignedLoad(srcty, ptr, llvm::Align(1));
-    if (mo != farmdec::MO_NONE) {
-        load->setOrdering(Ordering(mo));
-        load->setAlignment(llvm::Align(srcty->getPrimitiveSizeInBits() / 8));
+    llvm::Value* val = mo == farmdec::MO_NONE ? LoadReadOnly(srcty, ptr) : nullptr;
+    if (!val) {
+        llvm::LoadInst* load = irb.CreateAlignedLoad(srcty, ptr, llvm::Align(1));
+        if (mo != farmdec::MO_NONE) {
+            load->setOrdering(Ordering(mo));
+            load->setAlignment(llvm::Align(srcty->getPrimitiveSizeInBits() / 8));
+        }
+        val = load;
     }
 
-    SetScalar(rt, load);
+    SetScalar(rt, val);
 }
 
 // Given a pointer ptr = *T, store the value val, which is truncated appropriately.
@@ -47,8 +47,9 @@
 
 namespace rellume {
 
-ArchBasicBlock::ArchBasicBlock(llvm::Function* fn, size_t max_preds)
-        : max_preds(max_preds) {
+ArchBasicBlock::ArchBasicBlock(llvm::Function* fn, size_t max_preds,
+                               RegFile::Arena& arena)
+        : arena(arena), max_preds(max_preds) {
     llvm_block = llvm::BasicBlock::Create(fn->getContext(), "", fn, nullptr);
 
     if (max_preds != SIZE_MAX)
@@ -98,12 +99,32 @@ void ArchBasicBlock::BranchTo(llvm::Value* cond, ArchBasicBlock& then,
     successors.push_back(&other);
 }
 
+void ArchBasicBlock::BranchTo(llvm::Value* value, ArchBasicBlock& other,
+                              llvm::ArrayRef<std::pair<uint64_t, ArchBasicBlock*>> cases) {
+    assert(!EndBlock()->getTerminator() && "attempting to add second terminator");
+
+    llvm::IRBuilder<> irb(EndBlock());
+    auto switch_inst = irb.CreateSwitch(value, other.llvm_block, cases.size());
+    regfile->SetInsertPoint(switch_inst->getIterator());
+    other.predecessors.push_back(this);
+    successors.push_back(&other);
+    for (const auto& [case_value, target] : cases) {
+        switch_inst->addCase(irb.getInt64(case_value), target->llvm_block);
+        target->predecessors.push_back(this);
+        successors.push_back(target);
+    }
+}
+
 bool ArchBasicBlock::FillPhis() {
     assert(predecessors.size() <= max_preds);
     if (empty_phis.empty())
         return false;
 
-    for (const auto& [reg, facet, phi] : empty_phis) {
+    // Getting values from a predecessor can add new PHIs to that predecessor,
+    // which might be this block for self-loops.
+    auto phis = std::move(empty_phis);
+    empty_phis.clear();
+    for (const auto& [reg, facet, phi] : phis) {
         for (ArchBasicBlock* pred : predecessors) {
             llvm::Value* value = pred->regfile->GetReg(reg, facet);
             phi->addIncoming(value, pred->EndBlock());
@@ -112,7 +133,6 @@ bool ArchBasicBlock::FillPhis() {
             }
         }
     }
-    empty_phis.clear();
 
     return true;
 }
@@ -30,6 +30,7 @@
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Function.h>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 
@@ -37,7 +38,7 @@ namespace rellume {
 
 class ArchBasicBlock {
 public:
-    ArchBasicBlock(llvm::Function* fn, size_t max_preds);
+    ArchBasicBlock(llvm::Function* fn, size_t max_preds, RegFile::Arena& arena);
 
     ArchBasicBlock(ArchBasicBlock&& rhs);
     ArchBasicBlock& operator=(ArchBasicBlock&& rhs);
@@ -47,17 +48,25 @@ public:
 
     void BranchTo(ArchBasicBlock& next);
     void BranchTo(llvm::Value* cond, ArchBasicBlock& then, ArchBasicBlock& other);
+    /// Branch to the block of the matching case value, or to other.
+    void BranchTo(llvm::Value* value, ArchBasicBlock& other,
+                  llvm::ArrayRef<std::pair<uint64_t, ArchBasicBlock*>> cases);
+    /// Add incoming values to PHI nodes created since the last call. This may
+    /// create new PHI nodes in predecessors, see HasEmptyPhis.
     bool FillPhis();
+    bool HasEmptyPhis() const {
+        return !empty_phis.empty();
+    }
 
     void InitEmpty(Arch arch, llvm::BasicBlock* bb) {
-        regfile = std::make_unique<RegFile>(arch, bb);
+        regfile = arena.Create(arch, bb);
     }
     void InitWithPHIs(Arch arch, bool seal = false);
-    std::unique_ptr<RegFile> TakeRegFile() {
-        return std::move(regfile);
+    RegFile* TakeRegFile() {
+        return std::exchange(regfile, nullptr);
     }
     RegFile* GetRegFile() {
-        return regfile.get();
+        return regfile;
     }
 
     const llvm::ArrayRef<ArchBasicBlock*> Predecessors() const {
@@ -78,8 +87,9 @@ private:
     /// First LLVM basic block for the x86 basic block.
     llvm::BasicBlock* llvm_block;
 
-    /// The register file for the basic block
-    std::unique_ptr<RegFile> regfile;
+    /// The register file for the basic block, owned by the arena
+    RegFile* regfile = nullptr;
+    RegFile::Arena& arena;
 
     size_t max_preds;
     llvm::SmallVector<ArchBasicBlock*, 2> predecessors;
@@ -0,0 +1,134 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include "rellume/rellume.h"
+
+#include "config.h"
+#include "function.h"
+
+#include <llvm-c/Core.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Value.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+/// Values in the configuration which belong to a specific LLVMContext and
+/// therefore cannot be shared between workers.
+bool HasContextValues(const rellume::LLConfig& cfg) {
+    return cfg.global_base_value || cfg.pc_base_value ||
+           !cfg.instr_overrides.empty() || cfg.tail_function ||
+           cfg.call_function || cfg.syscall_implementation ||
+           cfg.cpuinfo_function || cfg.instr_marker ||
+           !cfg.lifted_functions.empty();
+}
+
+struct BatchState {
+    const uintptr_t* entries;
+    size_t count;
+    const rellume::LLConfig* cfg;
+    RellumeMemAccessCb mem_acc;
+    RellumeBatchInitCb init_cb;
+    RellumeBatchDoneCb done_cb;
+    void* user_arg;
+
+    /// Index of the next entry to lift.
+    std::atomic<size_t> next_entry{0};
+};
+
+void BatchWorker(BatchState* state) {
+    llvm::LLVMContext ctx;
+    auto mod = std::make_unique<llvm::Module>("rellume_batch", ctx);
+
+    // Each worker gets its own copy of the configuration, which the init
+    // callback can complete with values from the worker's context.
+    rellume::LLConfig cfg = *state->cfg;
+    if (state->init_cb)
+        state->init_cb(reinterpret_cast<LLConfig*>(&cfg), llvm::wrap(mod.get()),
+                       state->user_arg);
+
+    rellume::Function::MemReader memacc;
+    if (state->mem_acc) {
+        memacc = [state](uintptr_t addr, uint8_t* buf, size_t buf_sz) {
+            return state->mem_acc(addr, buf, buf_sz, state->user_arg);
+        };
+    }
+
+    std::vector<uintptr_t> entries;
+    std::vector<LLVMValueRef> fns;
+    while (true) {
+        size_t idx = state->next_entry.fetch_add(1, std::memory_order_relaxed);
+        if (idx >= state->count)
+            break;
+
+        rellume::Function func(mod.get(), &cfg);
+        llvm::Function* fn = nullptr;
+        uintptr_t entry = state->entries[idx];
+        if (!func.Decode(entry, rellume::Function::DecodeStop::ALL, memacc))
+            fn = func.Lift();
+        entries.push_back(entry);
+        fns.push_back(llvm::wrap(fn));
+    }
+
+    if (!entries.empty())
+        state->done_cb(llvm::wrap(mod.get()), entries.data(), fns.data(),
+                       entries.size(), state->user_arg);
+}
+
+} // end anonymous namespace
+
+int ll_batch_lift(const uintptr_t* entries, size_t count, const LLConfig* cfg,
+                  unsigned nthreads, RellumeMemAccessCb mem_acc,
+                  RellumeBatchInitCb init_cb, RellumeBatchDoneCb done_cb,
+                  void* user_arg) {
+    auto rl_cfg = reinterpret_cast<const rellume::LLConfig*>(cfg);
+    if (!done_cb || HasContextValues(*rl_cfg))
+        return -1;
+
+    BatchState state{entries, count, rl_cfg, mem_acc, init_cb, done_cb,
+                     user_arg};
+
+    if (nthreads == 0)
+        nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (nthreads > count)
+        nthreads = static_cast<unsigned>(count);
+
+    std::vector<std::thread> workers;
+    // The calling thread acts as one of the workers.
+    for (unsigned i = 1; i < nthreads; i++)
+        workers.emplace_back(BatchWorker, &state);
+    if (nthreads)
+        BatchWorker(&state);
+    for (auto& worker : workers)
+        worker.join();
+
+    return 0;
+}
@@ -37,37 +37,129 @@
 
 namespace rellume {
 
-CallConv CallConv::FromFunction(llvm::Function* fn, Arch arch) {
-    auto fn_cconv = fn->getCallingConv();
-    auto fn_ty = fn->getFunctionType();
-    CallConv hunch = INVALID;
+using CPUStructEntry = std::tuple<unsigned, unsigned, ArchReg, Facet>;
+
+// Note: replace with C++20 std::span.
+template<typename T>
+class span {
+    T* ptr;
+    std::size_t len;
+public:
+    constexpr span() : ptr(nullptr), len(0) {}
+    template<std::size_t N>
+    constexpr span(T (&arr)[N]) : ptr(arr), len(N) {}
+    constexpr std::size_t size() const { return len; }
+    constexpr T* begin() const { return &ptr[0]; }
+    constexpr T* end() const { return &ptr[len]; }
+};
+
+/// General purpose registers passed as arguments and returned in addition to
+/// the PC, in the order of the parameters.
+static span<const ArchReg> ArgRegs(CallConv cconv) {
+    static const ArchReg arg_regs_x86_64[] = {
+        ArchReg::RAX, ArchReg::RCX, ArchReg::RDX, ArchReg::RBX,
+        ArchReg::RSP, ArchReg::RBP, ArchReg::RSI, ArchReg::RDI,
+        ArchReg::GP(8), ArchReg::GP(9), ArchReg::GP(10), ArchReg::GP(11),
+    };
+    static const ArchReg arg_regs_aarch64[] = {
+        ArchReg::GP(0), ArchReg::GP(1), ArchReg::GP(2),
+        ArchReg::GP(3), ArchReg::GP(4), ArchReg::GP(5),
+    };
+
+    switch (cconv) {
+    default:
+        return span<const ArchReg>();
+    case CallConv::X86_64_HHVM:
+        return arg_regs_x86_64;
+    case CallConv::AArch64_REGS:
+        return arg_regs_aarch64;
+    }
+}
+
+/// General purpose registers that calls preserve according to the platform
+/// ABI, including the stack pointer.
+static span<const ArchReg> CalleeSavedRegs(Arch arch) {
     switch (arch) {
 #ifdef RELLUME_WITH_X86_64
-    case Arch::X86_64: hunch = X86_64_SPTR; break;
+    case Arch::X86_64: {
+        static const ArchReg regs[] = {
+            ArchReg::RBX, ArchReg::RSP, ArchReg::RBP, ArchReg::GP(12),
+            ArchReg::GP(13), ArchReg::GP(14), ArchReg::GP(15),
+        };
+        return regs;
+    }
 #endif // RELLUME_WITH_X86_64
 #ifdef RELLUME_WITH_RV64
-    case Arch::RV64: hunch = RV64_SPTR; break;
+    case Arch::RV64: {
+        static const ArchReg regs[] = {
+            ArchReg::GP(2), ArchReg::GP(8), ArchReg::GP(9), ArchReg::GP(18),
+            ArchReg::GP(19), ArchReg::GP(20), ArchReg::GP(21), ArchReg::GP(22),
+            ArchReg::GP(23), ArchReg::GP(24), ArchReg::GP(25), ArchReg::GP(26),
+            ArchReg::GP(27),
+        };
+        return regs;
+    }
 #endif // RELLUME_WITH_RV64
 #ifdef RELLUME_WITH_AARCH64
-    case Arch::AArch64: hunch = AArch64_SPTR; break;
+    case Arch::AArch64: {
+        static const ArchReg regs[] = {
+            ArchReg::GP(19), ArchReg::GP(20), ArchReg::GP(21), ArchReg::GP(22),
+            ArchReg::GP(23), ArchReg::GP(24), ArchReg::GP(25), ArchReg::GP(26),
+            ArchReg::GP(27), ArchReg::GP(28), ArchReg::GP(29), ArchReg::A64_SP,
+        };
+        return regs;
+    }
 #endif // RELLUME_WITH_AARCH64
     default:
-        return INVALID;
+        return span<const ArchReg>();
+    }
+}
+
+CallConv CallConv::Sptr(Arch arch) {
+    switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+    case Arch::X86_64: return X86_64_SPTR;
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_RV64
+    case Arch::RV64: return RV64_SPTR;
+#endif // RELLUME_WITH_RV64
+#ifdef RELLUME_WITH_AARCH64
+    case Arch::AArch64: return AArch64_SPTR;
+#endif // RELLUME_WITH_AARCH64
+    default: return INVALID;
+    }
+}
+
+CallConv CallConv::RegisterPassing(Arch arch) {
+    switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+    case Arch::X86_64: return X86_64_HHVM;
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_AARCH64
+    case Arch::AArch64: return AArch64_REGS;
+#endif // RELLUME_WITH_AARCH64
+    default: return INVALID;
     }
+}
 
-    // Verify hunch.
-    if (hunch.FnCallConv() != fn_cconv)
-        return INVALID;
-    unsigned sptr_idx = hunch.CpuStructParamIdx();
-    if (sptr_idx >= fn->arg_size())
-        return INVALID;
-    llvm::Type* sptr_ty = fn->arg_begin()[sptr_idx].getType();
-    if (!sptr_ty->isPointerTy())
-        return INVALID;
-    unsigned sptr_addrspace = sptr_ty->getPointerAddressSpace();
-    if (fn_ty != hunch.FnType(fn->getContext(), sptr_addrspace))
-        return INVALID;
-    return hunch;
+CallConv CallConv::FromFunction(llvm::Function* fn, Arch arch) {
+    auto fn_cconv = fn->getCallingConv();
+    auto fn_ty = fn->getFunctionType();
+    // The function must have exactly the type that a convention generates.
+    for (CallConv cconv : {Sptr(arch), RegisterPassing(arch)}) {
+        if (cconv == INVALID || cconv.FnCallConv() != fn_cconv)
+            continue;
+        unsigned sptr_idx = cconv.CpuStructParamIdx();
+        if (sptr_idx >= fn->arg_size())
+            continue;
+        llvm::Type* sptr_ty = fn->arg_begin()[sptr_idx].getType();
+        if (!sptr_ty->isPointerTy())
+            continue;
+        unsigned sptr_addrspace = sptr_ty->getPointerAddressSpace();
+        if (fn_ty == cconv.FnType(fn->getContext(), sptr_addrspace))
+            return cconv;
+    }
+    return INVALID;
 }
 
 llvm::FunctionType* CallConv::FnType(llvm::LLVMContext& ctx,
@@ -82,6 +174,17 @@ llvm::FunctionType* CallConv::FnType(llvm::LLVMContext& ctx,
     case CallConv::RV64_SPTR:
     case CallConv::AArch64_SPTR:
         return llvm::FunctionType::get(void_ty, {ptrTy}, false);
+    case CallConv::X86_64_HHVM:
+    case CallConv::AArch64_REGS: {
+        llvm::Type* i64 = llvm::Type::getInt64Ty(ctx);
+        // PC and registers are returned, followed by the registers.
+        size_t reg_count = 1 + ArgRegs(*this).size();
+        llvm::SmallVector<llvm::Type*, 16> params(1 + reg_count, i64);
+        params[0] = ptrTy;
+        llvm::SmallVector<llvm::Type*, 16> ret_tys(reg_count, i64);
+        llvm::Type* ret_ty = llvm::StructType::get(ctx, ret_tys);
+        return llvm::FunctionType::get(ret_ty, params, false);
+    }
     }
 }
 
@@ -91,6 +194,8 @@ llvm::CallingConv::ID CallConv::FnCallConv() const {
     case CallConv::X86_64_SPTR: return llvm::CallingConv::C;
     case CallConv::RV64_SPTR: return llvm::CallingConv::C;
     case CallConv::AArch64_SPTR: return llvm::CallingConv::C;
+    case CallConv::X86_64_HHVM: return llvm::CallingConv::HHVM;
+    case CallConv::AArch64_REGS: return llvm::CallingConv::C;
     }
 }
 
@@ -100,6 +205,8 @@ unsigned CallConv::CpuStructParamIdx() const {
     case CallConv::X86_64_SPTR:  return 0;
     case CallConv::RV64_SPTR:    return 0;
     case CallConv::AArch64_SPTR: return 0;
+    case CallConv::X86_64_HHVM:  return 0;
+    case CallConv::AArch64_REGS: return 0;
     }
 }
 
@@ -109,24 +216,34 @@ Arch CallConv::ToArch() const {
     case CallConv::X86_64_SPTR:  return Arch::X86_64;
     case CallConv::RV64_SPTR:    return Arch::RV64;
     case CallConv::AArch64_SPTR: return Arch::AArch64;
+    case CallConv::X86_64_HHVM:  return Arch::X86_64;
+    case CallConv::AArch64_REGS: return Arch::AArch64;
     }
 }
 
-using CPUStructEntry = std::tuple<unsigned, unsigned, ArchReg, Facet>;
 
-// Note: replace with C++20 std::span.
-template<typename T>
-class span {
-    T* ptr;
-    std::size_t len;
-public:
-    constexpr span() : ptr(nullptr), len(0) {}
-    template<std::size_t N>
-    constexpr span(T (&arr)[N]) : ptr(arr), len(N) {}
-    constexpr std::size_t size() const { return len; }
-    constexpr T* begin() const { return &ptr[0]; }
-    constexpr T* end() const { return &ptr[len]; }
-};
+unsigned CallConv::CpuStructSize() const {
+    switch (*this) {
+    default:
+        return 0;
+#define RELLUME_CPU_STRUCT_SIZE(size) return size;
+#ifdef RELLUME_WITH_X86_64
+    case CallConv::X86_64_SPTR:
+    case CallConv::X86_64_HHVM:
+#include <rellume/cpustruct-x86_64-private.inc>
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_RV64
+    case CallConv::RV64_SPTR:
+#include <rellume/cpustruct-rv64-private.inc>
+#endif // RELLUME_WITH_RV64
+#ifdef RELLUME_WITH_AARCH64
+    case CallConv::AArch64_SPTR:
+    case CallConv::AArch64_REGS:
+#include <rellume/cpustruct-aarch64-private.inc>
+#endif // RELLUME_WITH_AARCH64
+#undef RELLUME_CPU_STRUCT_SIZE
+    }
+}
 
 static span<const CPUStructEntry> CPUStructEntries(CallConv cconv) {
 #ifdef RELLUME_WITH_X86_64
@@ -161,6 +278,7 @@ static span<const CPUStructEntry> CPUStructEntries(CallConv cconv) {
         return span<const CPUStructEntry>();
 #ifdef RELLUME_WITH_X86_64
     case CallConv::X86_64_SPTR:
+    case CallConv::X86_64_HHVM:
         return cpu_struct_entries_x86_64;
 #endif // RELLUME_WITH_X86_64
 #ifdef RELLUME_WITH_RV64
@@ -169,6 +287,7 @@ static span<const CPUStructEntry> CPUStructEntries(CallConv cconv) {
 #endif // RELLUME_WITH_RV64
 #ifdef RELLUME_WITH_AARCH64
     case CallConv::AArch64_SPTR:
+    case CallConv::AArch64_REGS:
         return cpu_struct_entries_aarch64;
 #endif // RELLUME_WITH_AARCH64
     }
@@ -185,21 +304,40 @@ void CallConv::InitSptrs(ArchBasicBlock* bb, FunctionInfo& fi) {
         fi.sptr[sptr_idx] = irb.CreateConstGEP1_64(i8, fi.sptr_raw, off);
 }
 
-static void Pack(ArchBasicBlock* bb, FunctionInfo& fi, llvm::Instruction* before) {
+static void Pack(CallConv cconv, ArchBasicBlock* bb, FunctionInfo& fi,
+                 llvm::Instruction* before) {
     CallConvPack& pack_info = fi.call_conv_packs.emplace_back();
     pack_info.regfile = bb->TakeRegFile();
     pack_info.packBefore = before;
     pack_info.bb = bb;
+    pack_info.cconv = cconv;
+}
+
+/// PC and registers passed as values, in the order of the function type.
+static llvm::SmallVector<llvm::Value*, 16> PassedValues(CallConv cconv,
+                                                        RegFile& regfile,
+                                                        FunctionInfo& fi) {
+    llvm::SmallVector<llvm::Value*, 16> values;
+    if (ArgRegs(cconv).size() == 0)
+        return values;
+    values.push_back(regfile.GetPCValue(fi.pc_base_value, fi.pc_base_addr));
+    for (ArchReg reg : ArgRegs(cconv))
+        values.push_back(regfile.GetReg(reg, Facet::I64));
+    return values;
 }
 
+/// Unpack registers into a new register file. If pc is null, it is loaded
+/// from the CPU struct; registers for which get_from_reg returns null, too.
 template<typename F>
-static void Unpack(CallConv cconv, ArchBasicBlock* bb, llvm::BasicBlock* llvmBlock, FunctionInfo& fi, F get_from_reg) {
+static void Unpack(CallConv cconv, ArchBasicBlock* bb, llvm::BasicBlock* llvmBlock, FunctionInfo& fi, llvm::Value* pc, F get_from_reg) {
     bb->InitEmpty(cconv.ToArch(), llvmBlock);
     // New regfile with everything cleared
     RegFile& regfile = *bb->GetRegFile();
     llvm::IRBuilder<> irb(regfile.GetInsertBlock());
 
-    regfile.SetPC(irb.CreateLoad(irb.getInt64Ty(), fi.sptr_raw));
+    if (!pc)
+        pc = irb.CreateLoad(irb.getInt64Ty(), fi.sptr_raw);
+    regfile.SetPC(pc);
     for (const auto& [sptr_idx, off, reg, facet] : CPUStructEntries(cconv)) {
         if (reg.Kind() == ArchReg::RegKind::INVALID)
             continue;
@@ -217,31 +355,63 @@ static void Unpack(CallConv cconv, ArchBasicBlock* bb, llvm::BasicBlock* llvmBlo
 }
 
 llvm::ReturnInst* CallConv::Return(ArchBasicBlock* bb, FunctionInfo& fi) const {
-    llvm::IRBuilder<> irb(bb->GetRegFile()->GetInsertBlock());
-    llvm::ReturnInst* ret = irb.CreateRetVoid();
-    Pack(bb, fi, ret);
+    RegFile& regfile = *bb->GetRegFile();
+    auto values = PassedValues(*this, regfile, fi);
+    llvm::IRBuilder<> irb(regfile.GetInsertBlock());
+    llvm::ReturnInst* ret;
+    if (values.empty())
+        ret = irb.CreateRetVoid();
+    else
+        ret = irb.CreateAggregateRet(values.data(), values.size());
+    Pack(*this, bb, fi, ret);
     return ret;
 }
 
 void CallConv::UnpackParams(ArchBasicBlock* bb, FunctionInfo& fi) const {
-    Unpack(*this, bb, bb->BeginBlock(), fi, [&fi] (ArchReg reg) {
+    auto arg_regs = ArgRegs(*this);
+    llvm::Argument* args = fi.fn->arg_begin();
+    llvm::Value* pc = arg_regs.size() ? &args[1] : nullptr;
+    Unpack(*this, bb, bb->BeginBlock(), fi, pc, [&] (ArchReg reg) -> llvm::Value* {
+        for (size_t i = 0; i < arg_regs.size(); i++)
+            if (arg_regs.begin()[i] == reg)
+                return &args[2 + i];
         return nullptr;
     });
 }
 
 llvm::CallInst* CallConv::Call(llvm::Function* fn, ArchBasicBlock* bb,
-                               FunctionInfo& fi, bool tail_call) {
+                               FunctionInfo& fi, bool tail_call,
+                               bool keep_callee_saved) {
     llvm::SmallVector<llvm::Value*, 16> call_args;
-    call_args.resize(fn->arg_size());
-    call_args[CpuStructParamIdx()] = fi.sptr_raw;
+    call_args.push_back(fi.sptr_raw);
+    call_args.append(PassedValues(*this, *bb->GetRegFile(), fi));
+    assert(call_args.size() == fn->arg_size());
 
     llvm::IRBuilder<> irb(bb->EndBlock());
 
+    // Values of callee-saved registers before the call. The callee stores
+    // the same values back into the CPU struct, so they remain valid and
+    // need no reload afterwards.
+    span<const ArchReg> saved_regs;
+    llvm::SmallVector<llvm::Value*, 16> saved_vals;
+    if (keep_callee_saved && !tail_call) {
+        saved_regs = CalleeSavedRegs(ToArch());
+        for (ArchReg reg : saved_regs) {
+            llvm::Value* val = bb->GetRegFile()->GetReg(reg, Facet::I64);
+#ifdef RELLUME_WITH_X86_64
+            // The callee pops the return address pushed before the call.
+            if (ToArch() == Arch::X86_64 && reg == ArchReg::RSP)
+                val = irb.CreateAdd(val, irb.getInt64(8));
+#endif // RELLUME_WITH_X86_64
+            saved_vals.push_back(val);
+        }
+    }
+
     llvm::CallInst* call = irb.CreateCall(fn->getFunctionType(), fn, call_args);
     call->setCallingConv(fn->getCallingConv());
     call->setAttributes(fn->getAttributes());
 
-    Pack(bb, fi, call);
+    Pack(*this, bb, fi, call);
 
     if (tail_call) {
         call->setTailCallKind(llvm::CallInst::TCK_MustTail);
@@ -252,9 +422,28 @@ llvm::CallInst* CallConv::Call(llvm::Function* fn, ArchBasicBlock* bb,
         return call;
     }
 
-    Unpack(*this, bb, irb.GetInsertBlock(), fi, [] (ArchReg reg) {
+    auto arg_regs = ArgRegs(*this);
+    llvm::Value* pc = nullptr;
+    llvm::SmallVector<llvm::Value*, 16> ret_regs;
+    if (arg_regs.size()) {
+        pc = irb.CreateExtractValue(call, {0});
+        for (unsigned i = 0; i < arg_regs.size(); i++)
+            ret_regs.push_back(irb.CreateExtractValue(call, {1 + i}));
+    }
+    Unpack(*this, bb, irb.GetInsertBlock(), fi, pc, [&] (ArchReg reg) -> llvm::Value* {
+        for (size_t i = 0; i < saved_vals.size(); i++)
+            if (saved_regs.begin()[i] == reg)
+                return saved_vals[i];
+        for (size_t i = 0; i < ret_regs.size(); i++)
+            if (arg_regs.begin()[i] == reg)
+                return ret_regs[i];
         return nullptr;
     });
+    // The CPU struct already holds the preserved values, except for registers
+    // passed as values, which are never stored.
+    for (ArchReg reg : saved_regs)
+        if (!llvm::is_contained(arg_regs, reg))
+            bb->GetRegFile()->DirtyRegs()[RegisterSetBitIdx(reg)] = false;
 
     return call;
 }
@@ -310,8 +499,14 @@ void CallConv::OptimizePacks(FunctionInfo& fi, ArchBasicBlock* entry) {
         RegisterSet regset = regfile.DirtyRegs();
         if (!regfile.StartsClean())
             regset |= bb_map.lookup(pack.bb).first;
+        // Registers passed as values need no store.
+        auto arg_regs = ArgRegs(pack.cconv);
+        for (ArchReg reg : arg_regs)
+            regset[RegisterSetBitIdx(reg)] = false;
+
         llvm::IRBuilder<> irb(pack.packBefore);
-        irb.CreateStore(regfile.GetPCValue(fi.pc_base_value, fi.pc_base_addr), fi.sptr_raw);
+        if (arg_regs.size() == 0)
+            irb.CreateStore(regfile.GetPCValue(fi.pc_base_value, fi.pc_base_addr), fi.sptr_raw);
         for (const auto& [sptr_idx, off, reg, facet] : CPUStructEntries(*this)) {
             if (reg.Kind() == ArchReg::RegKind::INVALID)
                 continue;
@@ -43,12 +43,19 @@ struct FunctionInfo;
 class CallConv {
 public:
     /// HHVM: x86_64 calling convention that uses many registers for passing arguments
-    /// and return values. See LLVM documentation on that topic.
+    /// and return values. See LLVM documentation on that topic. The CPU struct
+    /// pointer is the first argument, followed by the PC and the most commonly
+    /// used general purpose registers; PC and these registers are returned in
+    /// an aggregate. All other registers are passed in the CPU struct.
+    ///
+    /// REGS: Same as HHVM, but using the C calling convention and fewer
+    /// registers such that all arguments are passed in host registers.
     ///
     /// SPTR: Cdecl callconv with one argument, the CPU struct pointer (sptr). See
     /// FunctionInfo.
     enum Value {
         INVALID, X86_64_SPTR, RV64_SPTR, AArch64_SPTR,
+        X86_64_HHVM, AArch64_REGS,
     };
 
     static CallConv FromFunction(llvm::Function* fn, Arch arch);
@@ -57,7 +64,13 @@ public:
                                unsigned sptr_addrspace) const;
     llvm::CallingConv::ID FnCallConv() const;
     unsigned CpuStructParamIdx() const;
+    /// Size of the CPU struct in bytes.
+    unsigned CpuStructSize() const;
     Arch ToArch() const;
+    /// SPTR convention for the architecture, or INVALID.
+    static CallConv Sptr(Arch arch);
+    /// Register-passing convention for the architecture, or INVALID.
+    static CallConv RegisterPassing(Arch arch);
 
     void InitSptrs(ArchBasicBlock* bb, FunctionInfo& fi);
 
@@ -70,8 +83,11 @@ public:
     void UnpackParams(ArchBasicBlock* bb, FunctionInfo& fi) const;
 
     /// Call the function fn at the end of block bb of the lifted function fi.
+    /// If keep_callee_saved is set, the callee is assumed to follow the
+    /// platform ABI and registers it preserves keep their values.
     llvm::CallInst* Call(llvm::Function* fn, ArchBasicBlock* bb,
-                         FunctionInfo& fi, bool tail_call = false);
+                         FunctionInfo& fi, bool tail_call = false,
+                         bool keep_callee_saved = false);
 
     /// Optimize a function's CallConvPacks to minimize the number of store
     /// instructions passed to the LLVM optimizer.
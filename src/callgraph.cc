@@ -0,0 +1,90 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file
+ **/
+
+#include "rellume/rellume.h"
+
+#include "config.h"
+#include "function.h"
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Value.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+LLVMValueRef ll_lift_call_graph(LLVMModuleRef mod_ref, LLConfig* cfg_ref,
+                                uintptr_t root, RellumeMemAccessCb mem_acc,
+                                void* user_arg) {
+    llvm::Module* mod = llvm::unwrap(mod_ref);
+    auto cfg = reinterpret_cast<rellume::LLConfig*>(cfg_ref);
+    llvm::LLVMContext& ctx = mod->getContext();
+
+    rellume::Function::MemReader memacc;
+    if (mem_acc) {
+        memacc = [mem_acc, user_arg](uintptr_t addr, uint8_t* buf, size_t sz) {
+            return mem_acc(addr, buf, sz, user_arg);
+        };
+    }
+
+    // Decode all reachable functions and declare them first, so that their
+    // calls to each other can be lifted as direct calls.
+    std::vector<std::unique_ptr<rellume::Function>> funcs;
+    llvm::SmallVector<uint64_t, 16> worklist;
+    worklist.push_back(root);
+    while (!worklist.empty()) {
+        uint64_t addr = worklist.pop_back_val();
+        if (cfg->lifted_functions.count(addr))
+            continue;
+
+        auto func = std::make_unique<rellume::Function>(mod, cfg);
+        auto stop = rellume::Function::DecodeStop::ALL;
+        if (func->Decode(addr, stop, memacc) || func->IsEmpty())
+            continue;
+
+        auto fn_ty = cfg->callconv.FnType(ctx, cfg->sptr_addrspace);
+        auto fn = llvm::Function::Create(fn_ty, llvm::GlobalValue::ExternalLinkage,
+                                         "", mod);
+        fn->setCallingConv(cfg->callconv.FnCallConv());
+        cfg->lifted_functions[addr] = fn;
+
+        for (uint64_t target : func->CallTargets())
+            worklist.push_back(target);
+        funcs.push_back(std::move(func));
+    }
+
+    // Functions which fail to lift remain declarations.
+    bool success = true;
+    for (auto& func : funcs)
+        success &= func->Lift() != nullptr;
+
+    auto root_it = cfg->lifted_functions.find(root);
+    if (!success || root_it == cfg->lifted_functions.end())
+        return nullptr;
+    return llvm::wrap(root_it->second);
+}
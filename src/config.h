@@ -27,8 +27,11 @@
 #include "arch.h"
 #include "callconv.h"
 #include <cstdbool>
+#include <cstddef>
 #include <cstdint>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 
 namespace llvm {
@@ -48,14 +51,55 @@ struct LLConfig {
     bool enableFastMath = false;
     /// Make CALL and RET clobber all status flags.
     bool call_ret_clobber_flags = false;
+    /// Assume that code called through call_function follows the platform ABI
+    /// (SysV x86-64, LP64 RISC-V, AAPCS64) and preserves the callee-saved
+    /// general purpose registers and the stack pointer. Their values are then
+    /// kept across the call instead of being reloaded from the CPU struct.
+    bool call_preserve_callee_saved = false;
     /// Use native registers FS and GS for segmented memory access
     bool use_native_segment_base = false;
+    /// Use the x86 BMI2 intrinsics for PDEP and PEXT instead of a generic bit
+    /// loop. The lifted code must then be compiled for an x86 host with BMI2.
+    bool use_native_bmi2 = false;
+    /// Use the x86 intrinsics for CRC32, AES-NI and PCLMULQDQ instead of
+    /// generic IR. The host must then support SSE4.2, AES and PCLMUL.
+    bool use_native_crypto = false;
+    /// Promote the stack frame below the stack pointer at function entry to an
+    /// alloca if all accesses have constant offsets and the stack pointer
+    /// does not escape. Assumes that only the lifted code accesses its frame.
+    bool promote_stack_slots = false;
     /// Verify the IR after lifting.
     bool verify_ir = false;
     /// Don't use absolute instruction addresses to set RIP. The actual RIP is
     /// supplied as in the RIP register field of the CPU struct.
     bool position_independent_code = false;
 
+    /// Granularity in bytes for reading code through the memory access
+    /// callback; must be a power of two. If non-zero, entire pages are read
+    /// and cached for the lifetime of the function, so that the callback is
+    /// only called once per page instead of once per instruction.
+    size_t decode_page_size = 0;
+
+    /// Limits for decoding a function; zero means unlimited. When a limit is
+    /// reached, decoding stops and branches to code not decoded leave the
+    /// function. The span is the distance between the lowest and highest
+    /// decoded code address.
+    size_t decode_max_instrs = 0;
+    size_t decode_max_blocks = 0;
+    uint64_t decode_max_span = 0;
+
+    /// Share decoded instructions between functions through a process-wide
+    /// cache, avoiding repeated decoding of the same code.
+    bool use_instr_cache = false;
+
+    /// Read-only memory ranges [start, end), whose contents do not change
+    /// while the lifted code runs, e.g. .rodata or a relocated GOT. Loads from
+    /// constant addresses inside these ranges are replaced by the value read
+    /// at lift time through ro_mem_read, or directly from memory if null.
+    std::vector<std::pair<uint64_t, uint64_t>> ro_mem_ranges;
+    size_t (*ro_mem_read)(size_t, uint8_t*, size_t, void*) = nullptr;
+    void* ro_mem_read_arg = nullptr;
+
     /// Instruction Set Architecture of the code to lift.
     Arch arch = Arch::DEFAULT;
 
@@ -90,6 +134,14 @@ struct LLConfig {
     /// tail_function.
     llvm::Function* call_function = nullptr;
 
+    /// Lifted functions in the same module, indexed by their entry address.
+    /// Calls through call_function and branches leaving the lifted code with
+    /// a constant target in this map call the lifted function directly. A
+    /// declaration registered for the entry of the code being lifted is used
+    /// as the function to lift into, so that functions can refer to each
+    /// other before they are lifted.
+    std::unordered_map<uint64_t, llvm::Function*> lifted_functions;
+
     /// Implementation of syscall semantics. If not specified, a syscall behaves
     /// as a no-op. The function must take a pointer to the CPU state as a
     /// single argument.
@@ -30,11 +30,6 @@
 
 namespace rellume {
 
-/**
- * \brief The size of a vector
- **/
-#define LL_VECTOR_REGISTER_SIZE 128
-
 class Facet {
 public:
     enum Value {
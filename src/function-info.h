@@ -24,6 +24,8 @@
 #ifndef RELLUME_FUNCTION_INFO_H
 #define RELLUME_FUNCTION_INFO_H
 
+#include "callconv.h"
+
 #include <cstdbool>
 #include <cstdint>
 #include <memory>
@@ -76,9 +78,13 @@ class RegFile;
 /// passing unnecessary store instructions to the LLVM optimiser, which
 /// would struggle with the many superfluous stores.
 struct CallConvPack {
-    std::unique_ptr<RegFile> regfile;
+    /// Register file of the block before the call; owned by the lift arena.
+    RegFile* regfile;
     llvm::Instruction* packBefore;
     ArchBasicBlock* bb;
+    /// Convention of the return or call; registers passed as values are not
+    /// stored to the CPU struct.
+    CallConv cconv;
 };
 
 /// FunctionInfo holds the LLVM objects of the lifted function and its
@@ -100,6 +106,10 @@ struct FunctionInfo {
     llvm::Value* pc_base_value;
 
     std::vector<CallConvPack> call_conv_packs;
+
+    /// Flags written by the instruction being lifted which are overwritten
+    /// before being read, as bit mask indexed by flag register index.
+    unsigned dead_flags = 0;
 };
 
 
@@ -33,8 +33,11 @@
 #include "x86-64/lifter.h"
 #include "rv64/lifter.h"
 #include "regfile.h"
+#include "stack-promotion.h"
 #include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
@@ -42,67 +45,255 @@
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/Allocator.h>
 #include <llvm/Transforms/Utils/BasicBlockUtils.h>
 #include <cassert>
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 
 namespace rellume {
 
+/// Remove PHI nodes that merge only a single value besides themselves, as
+/// described by Braun et al. (CC'13). Removing a PHI node can make PHI nodes
+/// using it trivial, so these are revisited.
+static void RemoveTrivialPhis(llvm::Function* fn) {
+    llvm::SmallVector<llvm::PHINode*, 64> worklist;
+    for (llvm::BasicBlock& bb : *fn)
+        for (llvm::PHINode& phi : bb.phis())
+            worklist.push_back(&phi);
+
+    llvm::SmallPtrSet<llvm::PHINode*, 32> erased;
+    while (!worklist.empty()) {
+        llvm::PHINode* phi = worklist.pop_back_val();
+        if (erased.contains(phi))
+            continue;
+
+        llvm::Value* same = nullptr;
+        bool trivial = true;
+        for (llvm::Value* value : phi->incoming_values()) {
+            if (value == same || value == phi)
+                continue;
+            if (same) {
+                trivial = false;
+                break;
+            }
+            same = value;
+        }
+        // PHIs without other incoming values are in unreachable blocks, which
+        // are removed later anyway.
+        if (!trivial || !same)
+            continue;
+
+        for (llvm::User* user : phi->users())
+            if (auto user_phi = llvm::dyn_cast<llvm::PHINode>(user))
+                if (user_phi != phi)
+                    worklist.push_back(user_phi);
+        phi->replaceAllUsesWith(same);
+        phi->eraseFromParent();
+        erased.insert(phi);
+    }
+}
+
+/// Attach TBAA metadata to memory accesses, so that accesses to the CPU struct
+/// are known not to alias guest memory accesses even after inlining. The tree
+/// root is named, so tags of different functions are compatible.
+static void AddTBAAMetadata(llvm::Function* fn, llvm::Value* sptr) {
+    llvm::MDBuilder mdb(fn->getContext());
+    llvm::MDNode* root = mdb.createTBAARoot("rellume TBAA");
+    llvm::MDNode* cpu_ty = mdb.createTBAAScalarTypeNode("cpu struct", root);
+    llvm::MDNode* mem_ty = mdb.createTBAAScalarTypeNode("guest memory", root);
+    llvm::MDNode* cpu_tag = mdb.createTBAAStructTagNode(cpu_ty, cpu_ty, 0);
+    llvm::MDNode* mem_tag = mdb.createTBAAStructTagNode(mem_ty, mem_ty, 0);
+
+    for (llvm::Instruction& inst : llvm::instructions(fn)) {
+        llvm::Value* ptr = llvm::getLoadStorePointerOperand(&inst);
+        if (auto rmw = llvm::dyn_cast<llvm::AtomicRMWInst>(&inst))
+            ptr = rmw->getPointerOperand();
+        else if (auto cmpxchg = llvm::dyn_cast<llvm::AtomicCmpXchgInst>(&inst))
+            ptr = cmpxchg->getPointerOperand();
+        if (!ptr)
+            continue;
+        // Promoted stack slots need no metadata.
+        llvm::Value* obj = llvm::getUnderlyingObject(ptr, /*MaxLookup=*/0);
+        if (llvm::isa<llvm::AllocaInst>(obj))
+            continue;
+        inst.setMetadata(llvm::LLVMContext::MD_tbaa,
+                         obj == sptr ? cpu_tag : mem_tag);
+    }
+}
+
 class LiftHelper {
+    using LiftFn = bool(const Instr&, FunctionInfo&, const LLConfig&, ArchBasicBlock&) noexcept;
+
     Function* func;
+    LLConfig* cfg;
+    LiftFn* lift_fn;
+
+    /// Blocks and register files live until the end of the lift and are freed
+    /// together.
+    llvm::SpecificBumpPtrAllocator<ArchBasicBlock> block_alloc;
+    RegFile::Arena regfile_arena;
+
     FunctionInfo fi;
-    llvm::DenseMap<uint64_t, std::unique_ptr<ArchBasicBlock>> block_map;
+    /// Block for each instruction index, null if no block starts there.
+    std::vector<ArchBasicBlock*> block_map;
+
+    ArchBasicBlock* exit_block;
+    /// Blocks tail-calling other lifted functions, by their entry address.
+    llvm::DenseMap<uint64_t, ArchBasicBlock*> tail_blocks;
 
-    std::unique_ptr<ArchBasicBlock> exit_block;
+    /// Per instruction, written flags which are never read.
+    std::vector<uint8_t> dead_flags;
 
+    /// Whether a block was split during lifting, which requires lifting the
+    /// function again.
+    bool needs_relift = false;
+
+    ArchBasicBlock* CreateBlock(size_t max_preds) {
+        return new (block_alloc.Allocate()) ArchBasicBlock(fi.fn, max_preds,
+                                                           regfile_arena);
+    }
     ArchBasicBlock& ResolveAddr(uint64_t addr);
+    ArchBasicBlock& ResolveExit(uint64_t addr);
+    size_t LiftBlock(ArchBasicBlock& ab, size_t idx);
+    void LiftJumpTable(ArchBasicBlock& ab, llvm::ArrayRef<uint64_t> targets);
 
 public:
-    LiftHelper(Function* func) : func(func) {}
+    LiftHelper(Function* func) : func(func), cfg(func->cfg) {}
 
     llvm::Function* Lift();
+    bool NeedsRelift() const { return needs_relift; }
 };
 
 ArchBasicBlock& LiftHelper::ResolveAddr(uint64_t addr) {
     if (!addr)
         return *exit_block;
-    auto block_it = block_map.find(addr);
-    if (block_it != block_map.end())
-        return *(block_it->second);
-    // We haven't created the block yet -- are we going to lift sth into it?
+    // Are we going to lift something for that address?
     auto instr_it = func->instr_map.find(addr);
-    if (instr_it == func->instr_map.end() || !instr_it->second.decoded)
-        return *exit_block;
+    if (instr_it == func->instr_map.end() || !instr_it->second.decoded())
+        return ResolveExit(addr);
+    size_t instr_idx = instr_it->second.instr_idx;
+    if (block_map[instr_idx])
+        return *block_map[instr_idx];
 
     // Branches to instructions that we didn't identify as block start indicate
     // a mismatch between decoding and lifting. This can happen for indirect
-    // jumps which become constants during lifting. For now, ignore this.
-    // TODO: split block if not yet lifted, otw. duplicate?
-    if (!func->instrs[instr_it->second.instr_idx].new_block)
+    // jumps which become constants during lifting or for overlapping decode
+    // streams. Split the block there and lift the function again, so that the
+    // predecessor counts of all blocks are known before they are lifted.
+    if (!func->instrs.IsBlockStart(instr_idx)) {
+        func->MarkBlockStart(instr_idx);
+        func->split_entries.push_back(addr);
+        needs_relift = true;
         return *exit_block;
+    }
     // We will lift something for that address, so create the block.
-    auto ab = std::make_unique<ArchBasicBlock>(fi.fn, instr_it->second.preds);
-    return *(block_map[addr] = std::move(ab));
+    size_t max_preds = instr_it->second.preds;
+    if (llvm::is_contained(func->split_entries, addr))
+        max_preds = SIZE_MAX;
+    return *(block_map[instr_idx] = CreateBlock(max_preds));
+}
+
+ArchBasicBlock& LiftHelper::ResolveExit(uint64_t addr) {
+    // Branches to other lifted functions become tail calls, which requires
+    // identical function types.
+    auto lifted_it = cfg->lifted_functions.find(addr);
+    if (lifted_it == cfg->lifted_functions.end())
+        return *exit_block;
+    llvm::Function* target = lifted_it->second;
+    if (target->getFunctionType() != fi.fn->getFunctionType() ||
+        target->getCallingConv() != fi.fn->getCallingConv())
+        return *exit_block;
+
+    ArchBasicBlock*& ab = tail_blocks[addr];
+    if (!ab)
+        ab = CreateBlock(SIZE_MAX);
+    return *ab;
+}
+
+size_t LiftHelper::LiftBlock(ArchBasicBlock& ab, size_t idx) {
+    const auto& instrs = func->instrs;
+    assert(!ab.GetRegFile());
+    ab.InitWithPHIs(cfg->arch);
+
+    for (size_t i = idx; i < instrs.size(); i++) {
+        Instr inst = instrs[i];
+
+        fi.dead_flags = dead_flags.empty() ? 0 : dead_flags[i];
+        bool success = lift_fn(inst, fi, *cfg, ab);
+        if (!success) {
+            if (i == 0) // failure at first instruction, propagate error
+                return SIZE_MAX;
+            // Skip forward to next block.
+            while (i < instrs.size() - 1 && !instrs.IsBlockStart(i + 1))
+                i += 1;
+        }
+
+        if (i < instrs.size() - 1 && !instrs.IsBlockStart(i + 1))
+            continue;
+
+        // Finish block by adding branches
+        RegFile* regfile = ab.GetRegFile();
+        if (!regfile || regfile->GetInsertBlock()->getTerminator())
+            return i + 1;
+        if (instrs.InhibitsBranch(i)) {
+            ab.BranchTo(*exit_block);
+            return i + 1;
+        }
+        auto [cond, addr1, addr2] = regfile->GetPCBranch(fi.pc_base_value, fi.pc_base_addr);
+        if (!addr1) {
+            auto jt_it = func->jump_tables.find(inst.start());
+            if (jt_it != func->jump_tables.end()) {
+                LiftJumpTable(ab, jt_it->second);
+                return i + 1;
+            }
+        }
+        if (auto cst = llvm::dyn_cast<llvm::ConstantInt>(cond))
+            ab.BranchTo(ResolveAddr(cst->isZero() ? addr2 : addr1));
+        else
+            ab.BranchTo(cond, ResolveAddr(addr1), ResolveAddr(addr2));
+        return i + 1;
+    }
+    return instrs.size();
+}
+
+void LiftHelper::LiftJumpTable(ArchBasicBlock& ab,
+                               llvm::ArrayRef<uint64_t> targets) {
+    RegFile* regfile = ab.GetRegFile();
+    llvm::Value* pc = regfile->GetPCValue(fi.pc_base_value, fi.pc_base_addr);
+    // Case values must be constants, so switch over the offset to the PC base
+    // for position-independent code.
+    uint64_t case_base = 0;
+    if (fi.pc_base_value) {
+        pc = llvm::BinaryOperator::CreateSub(pc, fi.pc_base_value, "",
+                                             ab.EndBlock());
+        case_base = fi.pc_base_addr;
+    }
+
+    llvm::SmallVector<std::pair<uint64_t, ArchBasicBlock*>, 16> cases;
+    for (uint64_t target : targets) {
+        ArchBasicBlock& target_ab = ResolveAddr(target);
+        // Unknown targets leave through the default edge anyway.
+        if (&target_ab != exit_block)
+            cases.emplace_back(target - case_base, &target_ab);
+    }
+    ab.BranchTo(pc, *exit_block, cases);
 }
 
 llvm::Function* LiftHelper::Lift() {
-    LLConfig* cfg = func->cfg;
     llvm::LLVMContext& ctx = func->mod->getContext();
 
     if (func->instrs.size() == 0)
         return nullptr;
 
-    uint64_t entry_ip = func->instrs[0].inst.start();
-    func->instr_map[entry_ip].preds++;
-
-    using LiftFn = bool(const Instr&, FunctionInfo&, const LLConfig&, ArchBasicBlock&) noexcept;
+    uint64_t entry_ip = func->instrs.Start(0);
 
-    LiftFn* lift_fn;
     switch (cfg->arch) {
 #ifdef RELLUME_WITH_X86_64
     case Arch::X86_64: lift_fn = x86_64::LiftInstruction; break;
@@ -117,9 +308,41 @@ llvm::Function* LiftHelper::Lift() {
         return nullptr;
     }
 
-    auto fn = llvm::Function::Create(cfg->callconv.FnType(ctx, cfg->sptr_addrspace),
-                                     llvm::GlobalValue::ExternalLinkage, "", func->mod);
+    // Called functions must have the type of a known calling convention.
+    auto has_invalid_cconv = [this](llvm::Function* ext_fn) {
+        return ext_fn && CallConv::FromFunction(ext_fn, cfg->arch) == CallConv::INVALID;
+    };
+    if (has_invalid_cconv(cfg->tail_function) ||
+        has_invalid_cconv(cfg->call_function) ||
+        has_invalid_cconv(cfg->syscall_implementation))
+        return nullptr;
+    for (const auto& [type, override_fn] : cfg->instr_overrides)
+        if (has_invalid_cconv(override_fn))
+            return nullptr;
+
+    // Lift into a declaration registered for the entry, if there is one.
+    llvm::FunctionType* fn_ty = cfg->callconv.FnType(ctx, cfg->sptr_addrspace);
+    llvm::Function* fn = nullptr;
+    bool keep_decl = false;
+    auto lifted_it = cfg->lifted_functions.find(entry_ip);
+    if (lifted_it != cfg->lifted_functions.end() &&
+        lifted_it->second->isDeclaration() &&
+        lifted_it->second->getParent() == func->mod &&
+        lifted_it->second->getFunctionType() == fn_ty) {
+        fn = lifted_it->second;
+        keep_decl = true;
+    } else {
+        fn = llvm::Function::Create(fn_ty, llvm::GlobalValue::ExternalLinkage,
+                                    "", func->mod);
+    }
     fn->setCallingConv(cfg->callconv.FnCallConv());
+    // On failure, registered declarations must remain valid for their users.
+    auto discard_fn = [fn, keep_decl] {
+        if (keep_decl)
+            fn->deleteBody();
+        else
+            fn->eraseFromParent();
+    };
 
     // CPU struct pointer parameters has some extra properties.
     unsigned cpu_param_idx = cfg->callconv.CpuStructParamIdx();
@@ -128,20 +351,27 @@ llvm::Function* LiftHelper::Lift() {
     fn->addParamAttr(cpu_param_idx, llvm::Attribute::NoCapture);
     auto align_attr = llvm::Attribute::get(ctx, llvm::Attribute::Alignment, 16);
     fn->addParamAttr(cpu_param_idx, align_attr);
-    fn->addDereferenceableParamAttr(cpu_param_idx, 0x190);
+    fn->addDereferenceableParamAttr(cpu_param_idx, cfg->callconv.CpuStructSize());
 
     fi.fn = fn;
     fi.sptr_raw = &fn->arg_begin()[cpu_param_idx];
 
     // Create entry basic block as first block in the function.
-    auto entry_block = std::make_unique<ArchBasicBlock>(fn, 0);
+    ArchBasicBlock* entry_block = CreateBlock(0);
     // Initialize the sptr pointers in the function info.
-    cfg->callconv.InitSptrs(entry_block.get(), fi);
+    cfg->callconv.InitSptrs(entry_block, fi);
     // And initially fill register file.
-    cfg->callconv.UnpackParams(entry_block.get(), fi);
+    cfg->callconv.UnpackParams(entry_block, fi);
+    // Stack pointer at entry and at exits, for promoting the stack frame.
+    llvm::Value* entry_sp = nullptr;
+    llvm::DenseMap<llvm::BasicBlock*, llvm::WeakTrackingVH> exit_sps;
+    ArchReg sp_reg = StackPointerReg(cfg->arch);
+    if (cfg->promote_stack_slots)
+        entry_sp = entry_block->GetRegFile()->GetReg(sp_reg, Facet::I64);
+    block_map.resize(func->instrs.size());
     entry_block->BranchTo(ResolveAddr(entry_ip));
 
-    exit_block = std::make_unique<ArchBasicBlock>(fn, SIZE_MAX);
+    exit_block = CreateBlock(SIZE_MAX);
 
     if (cfg->pc_base_value) {
         fi.pc_base_addr = cfg->pc_base_addr;
@@ -156,45 +386,23 @@ llvm::Function* LiftHelper::Lift() {
         }
     }
 
-    {
-        ArchBasicBlock* cur_ab = nullptr;
-        for (size_t i = 0; i < func->instrs.size(); i++) {
-            const auto& decinst = func->instrs[i];
-            if (decinst.new_block) {
-                cur_ab = &ResolveAddr(decinst.inst.start());
-                assert(!cur_ab->GetRegFile());
-                cur_ab->InitWithPHIs(cfg->arch);
-            }
-
-            bool success = lift_fn(decinst.inst, fi, *cfg, *cur_ab);
-            if (!success) {
-                if (i == 0) { // failure at first instruction, propagate error
-                    fn->eraseFromParent();
-                    return nullptr;
-                }
-                // Skip forward to next block.
-                while (i < func->instrs.size() - 1 && !func->instrs[i + 1].new_block)
-                    i += 1;
-            }
-
-            // Finish block by adding branches
-            if (i >= func->instrs.size() - 1 || func->instrs[i + 1].new_block) {
-                RegFile* regfile = cur_ab->GetRegFile();
-                if (!regfile || regfile->GetInsertBlock()->getTerminator())
-                    continue;
-                if (decinst.inhibit_branch) {
-                    cur_ab->BranchTo(*exit_block);
-                    continue;
-                }
-                auto [cond, addr1, addr2] = regfile->GetPCBranch(fi.pc_base_value, fi.pc_base_addr);
-                if (auto cst = llvm::dyn_cast<llvm::ConstantInt>(cond))
-                    cur_ab->BranchTo(ResolveAddr(cst->isZero() ? addr2 : addr1));
-                else
-                    cur_ab->BranchTo(cond, ResolveAddr(addr1), ResolveAddr(addr2));
-            }
+    dead_flags = func->ComputeDeadFlags();
+    for (size_t i = 0; i < func->instrs.size(); ) {
+        assert(func->instrs.IsBlockStart(i));
+        ArchBasicBlock& ab = ResolveAddr(func->instrs.Start(i));
+        i = LiftBlock(ab, i);
+        if (i == SIZE_MAX) {
+            discard_fn();
+            return nullptr;
         }
     }
 
+    // Blocks were split, the lifted code is incomplete.
+    if (needs_relift) {
+        discard_fn();
+        return nullptr;
+    }
+
     exit_block->InitWithPHIs(cfg->arch, /*seal=*/true);
     {
         llvm::BasicBlock* exitbb = exit_block->BeginBlock();
@@ -207,35 +415,70 @@ llvm::Function* LiftHelper::Lift() {
         exit_block->GetRegFile()->SetPC(phi);
     }
 
+    if (entry_sp) {
+        RegFile* exit_rf = exit_block->GetRegFile();
+        exit_sps[exit_block->EndBlock()] = exit_rf->GetReg(sp_reg, Facet::I64);
+    }
+
     // Exit block packs values together and optionally returns something.
     if (cfg->tail_function) {
         CallConv cconv = CallConv::FromFunction(cfg->tail_function, cfg->arch);
-        // Force a tail call to the specified function.
-        cconv.Call(cfg->tail_function, exit_block.get(), fi, true);
+        if (cfg->tail_function->getFunctionType() == fn->getFunctionType()) {
+            // Force a tail call to the specified function.
+            cconv.Call(cfg->tail_function, exit_block, fi, true);
+        } else {
+            // Different conventions, so we have to convert the result.
+            cconv.Call(cfg->tail_function, exit_block, fi);
+            cfg->callconv.Return(exit_block, fi);
+        }
     } else {
-        cfg->callconv.Return(exit_block.get(), fi);
+        cfg->callconv.Return(exit_block, fi);
     }
 
-    cfg->callconv.OptimizePacks(fi, entry_block.get());
+    for (auto [addr, ab] : tail_blocks) {
+        ab->InitWithPHIs(cfg->arch, /*seal=*/true);
+        ab->GetRegFile()->SetPC(addr);
+        if (entry_sp) {
+            RegFile* tail_rf = ab->GetRegFile();
+            exit_sps[ab->EndBlock()] = tail_rf->GetReg(sp_reg, Facet::I64);
+        }
+        cfg->callconv.Call(cfg->lifted_functions[addr], ab, fi, true);
+    }
 
-    // Walk over blocks as long as phi nodes could have been added. We stop when
-    // alls phis are filled.
-    // TODO: improve walk ordering and efficiency (e.g. by adding predecessors
-    // to the set of remaining blocks when something changed)
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (auto& item : block_map)
-            changed |= item.second->FillPhis();
-        changed |= exit_block->FillPhis();
+    cfg->callconv.OptimizePacks(fi, entry_block);
+
+    // Fill phi nodes. Filling can add new phi nodes to predecessors, so only
+    // these need to be revisited afterwards.
+    llvm::SmallVector<ArchBasicBlock*, 64> worklist;
+    worklist.push_back(exit_block);
+    for (auto [addr, ab] : tail_blocks)
+        worklist.push_back(ab);
+    for (ArchBasicBlock* ab : block_map)
+        if (ab)
+            worklist.push_back(ab);
+    while (!worklist.empty()) {
+        ArchBasicBlock* ab = worklist.pop_back_val();
+        if (!ab->FillPhis())
+            continue;
+        for (ArchBasicBlock* pred : ab->Predecessors())
+            if (pred->HasEmptyPhis())
+                worklist.push_back(pred);
     }
 
+    // Register files may refer to PHI nodes until all of them are filled, so
+    // remove trivial ones only now.
+    RemoveTrivialPhis(fn);
+
     // Remove blocks without predecessors. This can happen if constants get
     // folded already during construction, e.g. xor eax,eax;test eax,eax;jz
     llvm::EliminateUnreachableBlocks(*fn);
 
+    if (entry_sp)
+        PromoteStackSlots(fn, entry_sp, exit_sps);
+    AddTBAAMetadata(fn, fi.sptr_raw);
+
     if (cfg->verify_ir && llvm::verifyFunction(*(fn), &llvm::errs())) {
-        fn->eraseFromParent();
+        discard_fn();
         return nullptr;
     }
 
@@ -243,7 +486,14 @@ llvm::Function* LiftHelper::Lift() {
 }
 
 llvm::Function* Function::Lift() {
-    return LiftHelper(this).Lift();
+    // Each attempt only adds block starts, so this terminates. Usually, a
+    // single additional attempt suffices.
+    while (true) {
+        LiftHelper helper(this);
+        llvm::Function* fn = helper.Lift();
+        if (!helper.NeedsRelift())
+            return fn;
+    }
 }
 
 }
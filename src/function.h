@@ -24,12 +24,16 @@
 #ifndef LL_FUNCTION_H
 #define LL_FUNCTION_H
 
+#include "instr-list.h"
 #include "instr.h"
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Module.h>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <vector>
 
 
@@ -59,7 +63,34 @@ public:
         ALL,
     };
     using MemReader = std::function<size_t(uintptr_t, uint8_t*, size_t)>;
+    /// Decode using memacc to read code. If memacc is null, the code is read
+    /// directly from the host address space.
     int Decode(uintptr_t addr, DecodeStop stop, MemReader memacc = nullptr);
+    /// Decode further code starting at addr for an already decoded function,
+    /// e.g. a target of the indirect branch at branch_addr discovered at
+    /// run-time. That branch continues at addr, if applicable, but no other
+    /// branch does. Lift still lifts the whole function again.
+    int DecodeMore(uint64_t branch_addr, uintptr_t addr,
+                   MemReader memacc = nullptr);
+    /// Decode directly from buf, which contains the code located at base_addr.
+    /// Instructions outside of [base_addr, base_addr+len) are not decoded.
+    int DecodeSpan(uintptr_t addr, DecodeStop stop, uintptr_t base_addr,
+                   const uint8_t* buf, size_t len);
+
+    /// Whether no instruction was decoded.
+    bool IsEmpty() const {
+        return instrs.empty();
+    }
+
+    /// Whether decoding stopped early due to a budget in the configuration.
+    bool IsPartial() const {
+        return partial;
+    }
+
+    /// Targets of direct calls in the decoded code.
+    llvm::ArrayRef<uint64_t> CallTargets() const {
+        return call_targets;
+    }
 
     struct CodeRange {
         uint64_t start, end;
@@ -69,29 +100,70 @@ public:
     }
 
 private:
+    /// If direct is set, fetch reads from the host address space without
+    /// checking that the memory is mapped.
+    template<typename F>
+    int DecodeImpl(uintptr_t addr, DecodeStop stop, F fetch,
+                   bool direct = false);
+    template<typename F>
+    void DecodeJumpTable(size_t first_idx, F fetch, bool direct,
+                         llvm::SmallVectorImpl<uint64_t>& addr_stack);
+    /// Whether [addr, addr+size) is known to be mapped in the host address
+    /// space, because it is read-only memory or on a page with decoded code,
+    /// including the not yet recorded code range stream.
+    bool IsKnownReadable(uint64_t addr, size_t size, CodeRange stream) const;
+    void MarkBlockStart(size_t instr_idx);
+    bool DecodeBudgetExhausted(bool new_block) const;
+    bool InDecodeSpan(uint64_t addr) const;
+    size_t FetchCached(uintptr_t addr, const uint8_t** buf, uint8_t* inst_buf,
+                       size_t inst_buf_sz, MemReader& memacc);
+    /// Flags written by each instruction that are overwritten on all paths
+    /// before being read; empty if unsupported for the architecture.
+    std::vector<uint8_t> ComputeDeadFlags() const;
+
     llvm::Module* mod;
     LLConfig* cfg;
 
-    struct DecodedInstr {
-        Instr inst;
-        bool new_block;
-        /// Prevent branching from this instruction; used for calls
-        bool inhibit_branch;
-    };
-
-    std::vector<DecodedInstr> instrs;
+    InstrList instrs;
 
     struct InstrMapEntry {
         unsigned preds = 0;
-        /// Indicate whether the instruction was successfully decoded
-        bool decoded = false;
-        /// Index in instrs; only valid if decoded is true
-        size_t instr_idx = 0;
+        /// Index in instrs; UINT32_MAX if not (successfully) decoded
+        uint32_t instr_idx = UINT32_MAX;
+        bool decoded() const { return instr_idx != UINT32_MAX; }
     };
     llvm::DenseMap<uint64_t, InstrMapEntry> instr_map; // map addr -> instr
 
+    /// Number of decoded blocks and address range of decoded code, used for
+    /// checking the decode budget.
+    size_t num_blocks = 0;
+    uint64_t code_min = UINT64_MAX;
+    uint64_t code_max = 0;
+    bool partial = false;
+
+    /// Instructions in the middle of a decoded block which turned out to be
+    /// branch targets during lifting. Their blocks can have any number of
+    /// predecessors, as these edges are unknown to the decoder.
+    llvm::SmallVector<uint64_t, 4> split_entries;
+
+    /// Targets of indirect branches through jump tables or from DecodeMore,
+    /// indexed by the address of the branch instruction.
+    llvm::DenseMap<uint64_t, llvm::SmallVector<uint64_t, 8>> jump_tables;
+
+    llvm::SmallVector<uint64_t, 8> call_targets;
+
     llvm::SmallVector<CodeRange, 32> code_ranges = {{0, 0}};
 
+    struct CachedPage {
+        std::unique_ptr<uint8_t[]> data;
+        /// Number of valid bytes, smaller than the page size if the memory
+        /// could be read only partially.
+        size_t size;
+    };
+    /// Code pages read through the memory access callback; see
+    /// LLConfig::decode_page_size.
+    llvm::DenseMap<uint64_t, CachedPage> page_cache;
+
     friend class LiftHelper;
 };
 
@@ -0,0 +1,69 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include "instr-cache.h"
+
+#include <cstring>
+#include <mutex>
+
+
+namespace rellume {
+
+InstrCache& InstrCache::Get() {
+    static InstrCache cache;
+    return cache;
+}
+
+bool InstrCache::Lookup(Arch arch, uint64_t addr, const uint8_t* buf,
+                        size_t len, Instr& inst) {
+    Shard& shard = GetShard(addr);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.entries.find(Key{static_cast<unsigned>(arch), addr});
+    if (it == shard.entries.end())
+        return false;
+    const Entry& entry = it->second;
+    size_t inst_len = entry.inst.len();
+    if (len < inst_len || memcmp(buf, entry.bytes, inst_len))
+        return false;
+    inst = entry.inst;
+    return true;
+}
+
+void InstrCache::Insert(Arch arch, const Instr& inst, const uint8_t* buf) {
+    Shard& shard = GetShard(inst.start());
+    std::unique_lock lock(shard.mutex);
+    Entry& entry = shard.entries[Key{static_cast<unsigned>(arch), inst.start()}];
+    entry.inst = inst;
+    memcpy(entry.bytes, buf, inst.len());
+}
+
+void InstrCache::Invalidate(uint64_t start, uint64_t end) {
+    for (Shard& shard : shards) {
+        std::unique_lock lock(shard.mutex);
+        for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it)
+            if (it->first.second >= start && it->first.second < end)
+                shard.entries.erase(it);
+    }
+}
+
+} // namespace rellume
@@ -0,0 +1,80 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef RELLUME_INSTR_CACHE_H
+#define RELLUME_INSTR_CACHE_H
+
+#include "arch.h"
+#include "instr.h"
+#include <llvm/ADT/DenseMap.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <utility>
+
+
+namespace rellume {
+
+/// Process-wide cache of decoded instructions, shared between all functions.
+/// An entry is keyed by architecture and address and stores the instruction
+/// bytes, so that a lookup only succeeds if the code at the address is still
+/// identical. Lookups from multiple threads can proceed concurrently.
+class InstrCache {
+public:
+    static InstrCache& Get();
+
+    /// Look up the instruction at addr, where buf holds the len available code
+    /// bytes at that address. Returns true and fills inst on a hit.
+    bool Lookup(Arch arch, uint64_t addr, const uint8_t* buf, size_t len,
+                Instr& inst);
+    /// Add a successfully decoded instruction, buf holds its code bytes.
+    void Insert(Arch arch, const Instr& inst, const uint8_t* buf);
+    /// Drop all entries for instructions starting in [start, end).
+    void Invalidate(uint64_t start, uint64_t end);
+
+private:
+    InstrCache() = default;
+
+    struct Entry {
+        Instr inst;
+        uint8_t bytes[15];
+    };
+    using Key = std::pair<unsigned, uint64_t>;
+
+    /// Entries are distributed over multiple shards to reduce contention.
+    struct Shard {
+        std::shared_mutex mutex;
+        llvm::DenseMap<Key, Entry> entries;
+    };
+    static constexpr size_t kNumShards = 16;
+    std::array<Shard, kNumShards> shards;
+
+    Shard& GetShard(uint64_t addr) {
+        return shards[(addr ^ (addr >> 12)) % kNumShards];
+    }
+};
+
+} // namespace rellume
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef RELLUME_INSTR_LIST_H
+#define RELLUME_INSTR_LIST_H
+
+#include "arch.h"
+#include "instr.h"
+#include <llvm/ADT/BitVector.h>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace rellume {
+
+/// Decoded instructions of a function in decode order. Instructions are stored
+/// as structure of arrays: the decoder-specific data is kept in a packed array
+/// for the architecture of the function only, and block starts and inhibited
+/// branches are bitsets. Instructions are accessed by value.
+class InstrList {
+public:
+    size_t size() const { return addrs.size(); }
+    bool empty() const { return addrs.empty(); }
+
+    Instr operator[](size_t idx) const {
+        Instr inst;
+        inst.arch = arch;
+        inst.addr = addrs[idx];
+        inst.instlen = lens[idx];
+        switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+        case Arch::X86_64: inst.x86_64 = x86_64[idx]; break;
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_RV64
+        case Arch::RV64: inst.rv64 = rv64[idx]; break;
+#endif // RELLUME_WITH_RV64
+#ifdef RELLUME_WITH_AARCH64
+        case Arch::AArch64: inst._a64 = a64[idx]; break;
+#endif // RELLUME_WITH_AARCH64
+        default: break;
+        }
+        return inst;
+    }
+    Instr back() const { return (*this)[size() - 1]; }
+
+    /// Append an instruction; all instructions must have the same architecture.
+    void push_back(const Instr& inst) {
+        assert((empty() || inst.arch == arch) && "mixed architectures");
+        arch = inst.arch;
+        addrs.push_back(inst.addr);
+        lens.push_back(inst.instlen);
+        switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+        case Arch::X86_64: x86_64.push_back(inst.x86_64); break;
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_RV64
+        case Arch::RV64: rv64.push_back(inst.rv64); break;
+#endif // RELLUME_WITH_RV64
+#ifdef RELLUME_WITH_AARCH64
+        case Arch::AArch64: a64.push_back(inst._a64); break;
+#endif // RELLUME_WITH_AARCH64
+        default: break;
+        }
+        new_block.push_back(false);
+        inhibit_branch.push_back(false);
+    }
+
+    uint64_t Start(size_t idx) const { return addrs[idx]; }
+
+    /// Whether the instruction starts a new basic block.
+    bool IsBlockStart(size_t idx) const { return new_block[idx]; }
+    void SetBlockStart(size_t idx, bool value = true) {
+        new_block[idx] = value;
+    }
+    /// Prevent branching from this instruction; used for calls
+    bool InhibitsBranch(size_t idx) const { return inhibit_branch[idx]; }
+    void SetInhibitBranch(size_t idx) { inhibit_branch.set(idx); }
+
+private:
+    Arch arch = Arch::INVALID;
+    std::vector<uint64_t> addrs;
+    std::vector<uint8_t> lens;
+#ifdef RELLUME_WITH_X86_64
+    std::vector<FdInstr> x86_64;
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_RV64
+    std::vector<FrvInst> rv64;
+#endif // RELLUME_WITH_RV64
+#ifdef RELLUME_WITH_AARCH64
+    std::vector<farmdec::Inst> a64;
+#endif // RELLUME_WITH_AARCH64
+    llvm::BitVector new_block;
+    llvm::BitVector inhibit_branch;
+};
+
+} // namespace rellume
+
+#endif
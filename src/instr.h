@@ -59,6 +59,8 @@ class Instr {
 #endif // RELLUME_WITH_AARCH64
     };
 
+    friend class InstrList;
+
 public:
 
 #ifdef RELLUME_WITH_X86_64
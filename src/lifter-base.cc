@@ -26,9 +26,14 @@
 #include "function-info.h"
 #include "instr.h"
 
+#include <llvm/ADT/APInt.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 
+#include <cstring>
+
 namespace rellume {
 
 llvm::Value* LifterBase::AddrConst(uint64_t addr) {
@@ -43,9 +48,72 @@ llvm::Value* LifterBase::AddrConst(uint64_t addr) {
     return irb.CreateIntToPtr(irb.getInt64(addr), irb.getPtrTy());
 }
 
+llvm::Constant* LifterBase::LoadReadOnly(llvm::Type* ty, llvm::Value* ptr) {
+    if (cfg.ro_mem_ranges.empty() || !llvm::isa<llvm::Constant>(ptr))
+        return nullptr;
+    // Segment-relative addresses are not in the read-only ranges.
+    if (ptr->getType()->getPointerAddressSpace() != 0)
+        return nullptr;
+
+    // Constant addresses are an inttoptr or an offset to the global base.
+    const llvm::DataLayout& dl = GetModule()->getDataLayout();
+    llvm::APInt off(64, 0);
+    llvm::Value* base = ptr->stripAndAccumulateConstantOffsets(dl, off, true);
+    uint64_t addr = off.getZExtValue();
+    if (base == cfg.global_base_value) {
+        addr += cfg.global_base_addr;
+    } else if (auto expr = llvm::dyn_cast<llvm::ConstantExpr>(base)) {
+        auto base_addr = llvm::dyn_cast<llvm::ConstantInt>(expr->getOperand(0));
+        if (expr->getOpcode() != llvm::Instruction::IntToPtr || !base_addr)
+            return nullptr;
+        addr += base_addr->getZExtValue();
+    } else if (!llvm::isa<llvm::ConstantPointerNull>(base)) {
+        return nullptr;
+    }
+
+    uint8_t buf[64];
+    uint64_t size = dl.getTypeStoreSize(ty);
+    if (ty->isPointerTy() || size > sizeof(buf) || size * 8 != dl.getTypeSizeInBits(ty))
+        return nullptr;
+    bool read_only = false;
+    for (const auto& [start, end] : cfg.ro_mem_ranges)
+        read_only |= addr >= start && addr + size <= end && addr + size > addr;
+    if (!read_only)
+        return nullptr;
+
+    if (cfg.ro_mem_read) {
+        if (cfg.ro_mem_read(addr, buf, size, cfg.ro_mem_read_arg) < size)
+            return nullptr;
+    } else {
+        memcpy(buf, reinterpret_cast<const void*>(addr), size);
+    }
+
+    // All supported architectures are little-endian.
+    llvm::APInt val(size * 8, 0);
+    for (uint64_t i = 0; i < size; i++)
+        val.insertBits(buf[i], i * 8, 8);
+    llvm::Constant* res = llvm::ConstantInt::get(irb.getContext(), val);
+    return ty->isIntegerTy() ? res : llvm::ConstantExpr::getBitCast(res, ty);
+}
+
 void LifterBase::CallExternalFunction(llvm::Function* fn) {
+    bool is_call = fn == cfg.call_function;
+    // Call lifted functions of the same module directly.
+    if (is_call) {
+        auto lifted_it = cfg.lifted_functions.find(regfile->GetPCConst());
+        if (lifted_it != cfg.lifted_functions.end() &&
+            CallConv::FromFunction(lifted_it->second, cfg.arch) != CallConv::INVALID)
+            fn = lifted_it->second;
+    }
+    // The convention of the function actually called, which can differ from
+    // the one of call_function.
     CallConv cconv = CallConv::FromFunction(fn, cfg.arch);
-    llvm::CallInst* call = cconv.Call(fn, &ablock, fi);
+    // Only calls to other lifted code can rely on the platform ABI. Registers
+    // passed as values by cconv are never kept.
+    bool keep_callee_saved = is_call && cfg.call_preserve_callee_saved &&
+                             cconv != CallConv::INVALID;
+    llvm::CallInst* call = cconv.Call(fn, &ablock, fi, /*tail_call=*/false,
+                                      keep_callee_saved);
     assert(call && "failed to create call for external function");
     regfile = ablock.GetRegFile();
 
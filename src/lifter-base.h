@@ -102,7 +102,14 @@ protected:
             regfile->SetPC(inst_addr);
     }
     void SetIP(llvm::Value* addr) {
-        regfile->SetPC(addr);
+        // Constant targets, e.g. from read-only memory, are direct branches.
+        // These are absolute, so don't rebase them for position-independent
+        // code.
+        auto cst = llvm::dyn_cast<llvm::ConstantInt>(addr);
+        if (cst && !fi.pc_base_value)
+            regfile->SetPC(cst->getZExtValue());
+        else
+            regfile->SetPC(addr);
     }
     void SetIPCond(llvm::Value* cond, uint64_t addr1, uint64_t addr2) {
         regfile->SetPCCond(cond, addr1, addr2);
@@ -120,6 +127,9 @@ protected:
         return regfile->GetPCValue(fi.pc_base_value, fi.pc_base_addr, off);
     }
     llvm::Value* AddrConst(uint64_t addr);
+    /// Value loaded from ptr if it is a constant address in read-only memory,
+    /// see LLConfig::ro_mem_ranges; otherwise null.
+    llvm::Constant* LoadReadOnly(llvm::Type* ty, llvm::Value* ptr);
 
     void CallExternalFunction(llvm::Function* fn);
 
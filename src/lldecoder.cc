@@ -23,9 +23,17 @@
 #include "basicblock.h"
 #include "config.h"
 #include "instr.h"
+#include "instr-cache.h"
+#include "x86-64/lifter.h"
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MathExtras.h>
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <deque>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -41,7 +49,7 @@ enum class InstrKind {
     OTHER,
 };
 
-/// Returns pair of instr kind and absolute jump target (or zero)
+/// Returns pair of instr kind and absolute jump or call target (or zero)
 std::pair<InstrKind, uint64_t> classifyInstr(Arch arch, const Instr& inst) {
     std::uint64_t branch_target = 0;
     switch (arch) {
@@ -76,7 +84,9 @@ std::pair<InstrKind, uint64_t> classifyInstr(Arch arch, const Instr& inst) {
                 branch_target = inst.end() + inst.op(0).pcrel();
             return {InstrKind::BRANCH, branch_target};
         case FDI_CALL:
-            return {InstrKind::CALL, 0};
+            if (inst.op(0).is_pcrel())
+                branch_target = inst.end() + inst.op(0).pcrel();
+            return {InstrKind::CALL, branch_target};
         case FDI_RET:
         case FDI_SYSCALL:
         case FDI_INT:
@@ -104,7 +114,7 @@ std::pair<InstrKind, uint64_t> classifyInstr(Arch arch, const Instr& inst) {
             return {InstrKind::COND_BRANCH, inst.start() + rv64->imm};
         case FRV_JAL:
             if (rv64->rd)
-                return {InstrKind::CALL, 0};
+                return {InstrKind::CALL, inst.start() + rv64->imm};
             return {InstrKind::BRANCH, inst.start() + rv64->imm};
         case FRV_JALR:
             return {rv64->rd ? InstrKind::CALL : InstrKind::BRANCH, 0};
@@ -131,6 +141,7 @@ std::pair<InstrKind, uint64_t> classifyInstr(Arch arch, const Instr& inst) {
         case farmdec::A64_BR:
             return {InstrKind::BRANCH, 0};
         case farmdec::A64_BL:
+            return {InstrKind::CALL, inst.start() + a64->offset};
         case farmdec::A64_BLR:
             return {InstrKind::CALL, 0};
         case farmdec::A64_RET:
@@ -151,10 +162,468 @@ std::pair<InstrKind, uint64_t> classifyInstr(Arch arch, const Instr& inst) {
     }
 }
 
+/// Recognizes bounded jump tables by tracking symbolic register values over
+/// the straight-line code preceding an indirect branch. Only the common code
+/// sequences emitted by compilers are handled. The analysis need not be exact:
+/// the lifted branch still compares against the actual target address and
+/// leaves the function if it is not one of the recognized targets.
+class JumpTableAnalysis {
+public:
+    struct Table {
+        /// Table address, number of entries, and size of an entry in bytes.
+        uint64_t addr;
+        unsigned count;
+        unsigned size;
+        /// Whether the loaded entry is sign-extended.
+        bool sext;
+        /// Width to which the entry is truncated and re-extended before
+        /// shifting and adding the base.
+        unsigned ext_bits = 64;
+        bool ext_signed = false;
+        unsigned shift = 0;
+        uint64_t base = 0;
+
+        uint64_t Target(uint64_t entry) const {
+            if (sext)
+                entry = llvm::SignExtend64(entry, size * 8);
+            if (ext_bits < 64) {
+                entry &= (uint64_t{1} << ext_bits) - 1;
+                if (ext_signed)
+                    entry = llvm::SignExtend64(entry, ext_bits);
+            }
+            return base + (entry << shift);
+        }
+    };
+
+    void Update(Arch arch, const Instr& inst);
+    std::optional<Table> Resolve(Arch arch, const Instr& inst) const;
+
+private:
+    struct Value {
+        enum Kind {
+            UNKNOWN,
+            /// Constant value, stored in table.base
+            CONST,
+            /// Entry loaded from table
+            LOAD,
+            /// Computed jump target
+            TARGET,
+        };
+        Kind kind = UNKNOWN;
+        Table table;
+    };
+    /// Entry count limit to avoid decoding garbage for misidentified tables.
+    static constexpr uint64_t kMaxEntries = 4096;
+
+    std::array<Value, 32> regs;
+    /// Exclusive upper bound for the register value, or zero if unknown.
+    std::array<unsigned, 32> bounds = {};
+    /// Register and immediate of a compare instruction immediately preceding
+    /// the current instruction.
+    int cmp_reg = -1;
+    uint64_t cmp_imm = 0;
+
+    void Kill(unsigned reg) {
+        if (reg < regs.size()) {
+            regs[reg] = Value{};
+            bounds[reg] = 0;
+        }
+    }
+    void SetConst(unsigned reg, uint64_t value) {
+        Kill(reg);
+        if (reg < regs.size()) {
+            regs[reg].kind = Value::CONST;
+            regs[reg].table.base = value;
+        }
+    }
+    void SetBound(uint64_t bound) {
+        if (cmp_reg >= 0 && bound > 0 && bound <= kMaxEntries)
+            bounds[cmp_reg] = bound;
+    }
+    bool SetLoad(unsigned reg, uint64_t addr, unsigned idx, unsigned size,
+                 bool sext) {
+        if (idx >= regs.size() || !bounds[idx])
+            return false;
+        unsigned count = bounds[idx];
+        Kill(reg);
+        if (reg >= regs.size())
+            return true;
+        regs[reg].kind = Value::LOAD;
+        regs[reg].table = Table{addr, count, size, sext};
+        return true;
+    }
+    bool SetTarget(unsigned reg, unsigned base, unsigned entry,
+                   unsigned ext_bits, bool ext_signed, unsigned shift) {
+        if (base >= regs.size() || entry >= regs.size())
+            return false;
+        if (regs[base].kind != Value::CONST || regs[entry].kind != Value::LOAD)
+            return false;
+        Table table = regs[entry].table;
+        table.base = regs[base].table.base;
+        table.ext_bits = ext_bits;
+        table.ext_signed = ext_signed;
+        table.shift = shift;
+        Kill(reg);
+        if (reg < regs.size()) {
+            regs[reg].kind = Value::TARGET;
+            regs[reg].table = table;
+        }
+        return true;
+    }
+};
+
+#ifdef RELLUME_WITH_X86_64
+bool IsFlatAddr(const Instr::Op& op) {
+    return op.seg() != FD_REG_FS && op.seg() != FD_REG_GS && op.addrsz() == 8;
+}
+#endif // RELLUME_WITH_X86_64
+
+void JumpTableAnalysis::Update(Arch arch, const Instr& inst) {
+    int prev_cmp_reg = cmp_reg;
+    cmp_reg = -1;
+
+    switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+    case Arch::X86_64: {
+        auto dst = inst.op(0);
+        bool dst_gp = dst && dst.is_reg() && dst.reg().rt == FD_RT_GPL;
+        switch (inst.type()) {
+        case FDI_CMP:
+            if (dst_gp && inst.op(1).is_imm()) {
+                cmp_reg = dst.reg().ri;
+                cmp_imm = inst.op(1).imm();
+            }
+            return;
+        case FDI_JA: // index <= imm
+            cmp_reg = prev_cmp_reg;
+            SetBound(cmp_imm + 1);
+            cmp_reg = -1;
+            return;
+        case FDI_JNC: // index < imm
+            cmp_reg = prev_cmp_reg;
+            SetBound(cmp_imm);
+            cmp_reg = -1;
+            return;
+        case FDI_LEA:
+            if (dst_gp && dst.size() == 8 && inst.op(1).base().ri == FD_REG_IP &&
+                !inst.op(1).index()) {
+                SetConst(dst.reg().ri, inst.end() + inst.op(1).off());
+                return;
+            }
+            break;
+        case FDI_MOV:
+        case FDI_MOVSX:
+        case FDI_MOVZX:
+            if (!dst_gp)
+                break;
+            if (auto src = inst.op(1); src.is_imm() && dst.size() >= 4) {
+                uint64_t mask = dst.size() == 8 ? ~uint64_t{0} : 0xffffffff;
+                SetConst(dst.reg().ri, src.imm() & mask);
+                return;
+            } else if (src.is_reg() && src.reg().rt == FD_RT_GPL &&
+                       inst.type() == FDI_MOV && dst.size() >= 4) {
+                // Zero-extending copy keeps the bound of the index.
+                unsigned bound = bounds[src.reg().ri];
+                Kill(dst.reg().ri);
+                bounds[dst.reg().ri] = bound;
+                return;
+            } else if (src.is_mem() && src.scale() == src.size() &&
+                       IsFlatAddr(src)) {
+                uint64_t addr = src.off();
+                if (src.base()) {
+                    if (src.base().ri >= regs.size())
+                        break;
+                    const Value& base = regs[src.base().ri];
+                    if (base.kind != Value::CONST)
+                        break;
+                    addr += base.table.base;
+                }
+                bool sext = inst.type() == FDI_MOVSX;
+                if (SetLoad(dst.reg().ri, addr, src.index().ri, src.size(), sext))
+                    return;
+            }
+            break;
+        case FDI_ADD:
+            if (dst_gp && dst.size() == 8 && inst.op(1).is_reg()) {
+                unsigned reg = dst.reg().ri;
+                unsigned other = inst.op(1).reg().ri;
+                if (SetTarget(reg, reg, other, 64, false, 0) ||
+                    SetTarget(reg, other, reg, 64, false, 0))
+                    return;
+            }
+            break;
+        default:
+            break;
+        }
+        if (dst_gp)
+            Kill(dst.reg().ri);
+        return;
+    }
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_AARCH64
+    case Arch::AArch64: {
+        const farmdec::Inst* a64 = inst;
+        bool w32 = a64->flags & farmdec::W32;
+        switch (a64->op) {
+        case farmdec::A64_ADR:
+            SetConst(a64->rd, inst.start() + a64->offset);
+            return;
+        case farmdec::A64_ADRP:
+            SetConst(a64->rd, (inst.start() & ~uint64_t{0xfff}) + a64->offset);
+            return;
+        case farmdec::A64_ADD_IMM:
+            if (!w32 && a64->rn < regs.size() &&
+                regs[a64->rn].kind == Value::CONST) {
+                SetConst(a64->rd, regs[a64->rn].table.base + a64->imm);
+                return;
+            }
+            break;
+        case farmdec::A64_CMP_IMM:
+            cmp_reg = a64->rn < regs.size() ? a64->rn : -1;
+            cmp_imm = a64->imm;
+            return;
+        case farmdec::A64_BCOND:
+            cmp_reg = prev_cmp_reg;
+            switch (fad_get_cond(a64->flags)) {
+            case farmdec::COND_HI: SetBound(cmp_imm + 1); break; // index <= imm
+            case farmdec::COND_HS: SetBound(cmp_imm); break; // index < imm
+            default: break;
+            }
+            cmp_reg = -1;
+            return;
+        case farmdec::A64_LDR: {
+            farmdec::AddrMode mode = fad_get_addrmode(a64->flags);
+            farmdec::ExtendType ext = fad_get_mem_extend(a64->flags);
+            unsigned size = 1 << (ext & 3);
+            unsigned lsl = 0;
+            if (mode == farmdec::AM_OFF_REG)
+                lsl = a64->shift.amount;
+            else if (mode == farmdec::AM_OFF_EXT)
+                lsl = a64->extend.lsl;
+            else
+                break;
+            if (a64->rn >= regs.size() || regs[a64->rn].kind != Value::CONST)
+                break;
+            if ((lsl || size != 1) && (1u << lsl) != size)
+                break;
+            bool sext = ext == farmdec::SXTB || ext == farmdec::SXTH ||
+                        ext == farmdec::SXTW;
+            if (SetLoad(a64->rt, regs[a64->rn].table.base, a64->rm, size, sext))
+                return;
+            break;
+        }
+        case farmdec::A64_ADD_EXT: {
+            if (w32)
+                break;
+            unsigned bits = 64;
+            bool ext_signed = false;
+            switch (static_cast<farmdec::ExtendType>(a64->extend.type)) {
+            case farmdec::UXTB: bits = 8; break;
+            case farmdec::UXTH: bits = 16; break;
+            case farmdec::UXTW: bits = 32; break;
+            case farmdec::UXTX: bits = 64; break;
+            case farmdec::SXTB: bits = 8; ext_signed = true; break;
+            case farmdec::SXTH: bits = 16; ext_signed = true; break;
+            case farmdec::SXTW: bits = 32; ext_signed = true; break;
+            case farmdec::SXTX: bits = 64; ext_signed = true; break;
+            }
+            if (SetTarget(a64->rd, a64->rn, a64->rm, bits, ext_signed,
+                          a64->extend.lsl))
+                return;
+            break;
+        }
+        case farmdec::A64_ADD_SHIFTED:
+            if (w32 || a64->shift.type != farmdec::SH_LSL)
+                break;
+            if (SetTarget(a64->rd, a64->rn, a64->rm, 64, false, a64->shift.amount))
+                return;
+            break;
+        case farmdec::A64_LDP:
+            Kill(a64->rt);
+            Kill(a64->rt2);
+            return;
+        default:
+            break;
+        }
+        // Conservatively assume that the destination is overwritten. Loads use
+        // rt instead of rd.
+        Kill(a64->rd);
+        if (a64->op == farmdec::A64_LDR)
+            Kill(a64->rt);
+        return;
+    }
+#endif // RELLUME_WITH_AARCH64
+    default:
+        return;
+    }
+}
+
+auto JumpTableAnalysis::Resolve(Arch arch, const Instr& inst) const
+        -> std::optional<Table> {
+    unsigned target_reg = regs.size();
+    switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+    case Arch::X86_64: {
+        if (inst.type() != FDI_JMP)
+            return std::nullopt;
+        auto op = inst.op(0);
+        if (op.is_reg()) {
+            target_reg = op.reg().ri;
+            break;
+        }
+        // jmp [base+index*8] with absolute table entries
+        if (!op.is_mem() || op.scale() != 8 || !IsFlatAddr(op))
+            return std::nullopt;
+        uint64_t addr = op.off();
+        if (op.base()) {
+            if (op.base().ri >= regs.size())
+                return std::nullopt;
+            const Value& base = regs[op.base().ri];
+            if (base.kind != Value::CONST)
+                return std::nullopt;
+            addr += base.table.base;
+        }
+        unsigned idx = op.index().ri;
+        if (idx >= regs.size() || !bounds[idx])
+            return std::nullopt;
+        return Table{addr, bounds[idx], 8, false};
+    }
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_AARCH64
+    case Arch::AArch64: {
+        const farmdec::Inst* a64 = inst;
+        if (a64->op != farmdec::A64_BR)
+            return std::nullopt;
+        target_reg = a64->rn;
+        break;
+    }
+#endif // RELLUME_WITH_AARCH64
+    default:
+        return std::nullopt;
+    }
+
+    if (target_reg >= regs.size())
+        return std::nullopt;
+    const Value& target = regs[target_reg];
+    if (target.kind == Value::TARGET)
+        return target.table;
+    // Load of absolute addresses
+    if (target.kind == Value::LOAD && target.table.size == 8)
+        return target.table;
+    return std::nullopt;
+}
+
 } // end anonymous namespace
 
-int Function::Decode(uintptr_t addr, DecodeStop stop, MemReader memacc) {
-    uint8_t inst_buf[15];
+template<typename F>
+void Function::DecodeJumpTable(size_t first_idx, F fetch, bool direct,
+                               llvm::SmallVectorImpl<uint64_t>& addr_stack) {
+    Instr branch = instrs.back();
+    JumpTableAnalysis jta;
+    for (size_t i = first_idx; i < instrs.size() - 1; i++)
+        jta.Update(cfg->arch, instrs[i]);
+    auto table = jta.Resolve(cfg->arch, branch);
+    if (!table)
+        return;
+
+    // The current stream is not yet part of code_ranges.
+    CodeRange stream{instrs[first_idx].start(), branch.end()};
+    llvm::SmallVector<uint64_t, 16> targets;
+    for (unsigned i = 0; i < table->count; i++) {
+        uint64_t entry_addr = table->addr + i * table->size;
+        // The table location is derived from the code and might be wrong, so
+        // never read unmapped host memory.
+        if (direct && !IsKnownReadable(entry_addr, table->size, stream))
+            break;
+        const uint8_t* buf = nullptr;
+        size_t count = fetch(entry_addr, &buf);
+        if (count < table->size)
+            break;
+        uint64_t entry = 0;
+        for (unsigned j = 0; j < table->size; j++)
+            entry |= uint64_t{buf[j]} << (8 * j);
+        if (uint64_t target = table->Target(entry))
+            targets.push_back(target);
+    }
+    llvm::sort(targets);
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    for (uint64_t target : targets) {
+        auto& target_entry = instr_map.try_emplace(target).first->second;
+        target_entry.preds++;
+        if (!target_entry.decoded())
+            addr_stack.push_back(target);
+        else
+            MarkBlockStart(target_entry.instr_idx);
+    }
+    if (!targets.empty())
+        jump_tables[branch.start()] = std::move(targets);
+}
+
+bool Function::IsKnownReadable(uint64_t addr, size_t size,
+                               CodeRange stream) const {
+    if (addr + size < addr)
+        return false;
+    // Read-only ranges are read directly if there is no reader for them.
+    if (!cfg->ro_mem_read)
+        for (const auto& [start, end] : cfg->ro_mem_ranges)
+            if (addr >= start && addr + size <= end)
+                return true;
+
+    // Pages with decoded code are mapped.
+    constexpr uint64_t kPageMask = ~uint64_t{0xfff};
+    auto on_code_page = [&](uint64_t page) {
+        auto in_range = [&](uint64_t start, uint64_t end) {
+            return start < end && (start & kPageMask) <= page &&
+                   page <= ((end - 1) & kPageMask);
+        };
+        if (in_range(stream.start, stream.end))
+            return true;
+        for (const CodeRange& range : code_ranges)
+            if (in_range(range.start, range.end))
+                return true;
+        return false;
+    };
+    for (uint64_t page = addr & kPageMask; page <= ((addr + size - 1) & kPageMask);
+         page += 0x1000)
+        if (!on_code_page(page))
+            return false;
+    return true;
+}
+
+void Function::MarkBlockStart(size_t instr_idx) {
+    if (!instrs.IsBlockStart(instr_idx)) {
+        instrs.SetBlockStart(instr_idx);
+        num_blocks++;
+    }
+}
+
+bool Function::DecodeBudgetExhausted(bool new_block) const {
+    if (cfg->decode_max_instrs && instrs.size() >= cfg->decode_max_instrs)
+        return true;
+    if (new_block && cfg->decode_max_blocks &&
+        num_blocks >= cfg->decode_max_blocks)
+        return true;
+    return false;
+}
+
+bool Function::InDecodeSpan(uint64_t addr) const {
+    if (!cfg->decode_max_span || instrs.empty())
+        return true;
+    // Assume a minimum instruction length of one byte.
+    uint64_t span = std::max(code_max, addr + 1) - std::min(code_min, addr);
+    return span <= cfg->decode_max_span;
+}
+
+/// fetch is called with an address and a pointer to a buffer pointer; it must
+/// store the location of the code in the buffer pointer and return the number
+/// of available bytes.
+template<typename F>
+int Function::DecodeImpl(uintptr_t addr, DecodeStop stop, F fetch,
+                         bool direct) {
+    // The function entry has an additional predecessor.
+    if (instrs.empty())
+        instr_map[addr].preds++;
 
     llvm::SmallVector<uint64_t, 32> addr_stack;
     addr_stack.push_back(addr);
@@ -164,45 +633,80 @@ int Function::Decode(uintptr_t addr, DecodeStop stop, MemReader memacc) {
 
         bool new_block = true;
         uint64_t cur_addr = start_addr;
+        size_t first_idx = instrs.size();
         InstrMapEntry* instr_map_entry = &instr_map[cur_addr];
         while (true) {
-            if (instr_map_entry->decoded) {
-                instrs[instr_map_entry->instr_idx].new_block = true;
+            if (instr_map_entry->decoded()) {
+                MarkBlockStart(instr_map_entry->instr_idx);
                 break;
             }
 
-            size_t count = memacc(cur_addr, inst_buf, sizeof(inst_buf));
-            auto& instr = instrs.emplace_back(DecodedInstr{});
-
-            int ret = instr.inst.DecodeFrom(cfg->arch, inst_buf, count, cur_addr);
-            if (ret < 0) { // invalid or unknown instruction
-                instrs.erase(instrs.end() - 1);
+            // When running out of budget, stop decoding; branches to code
+            // that was not decoded leave the function.
+            if (DecodeBudgetExhausted(new_block)) {
+                partial = true;
+                addr_stack.clear();
+                break;
+            }
+            if (!InDecodeSpan(cur_addr)) {
+                partial = true;
                 break;
             }
 
-            instr_map_entry->instr_idx = instrs.size() - 1;
-            instr_map_entry->decoded = true;
-            instr.new_block = new_block;
-            cur_addr += instr.inst.len();
+            const uint8_t* inst_buf = nullptr;
+            size_t count = fetch(cur_addr, &inst_buf);
+            Instr inst;
+
+            int ret;
+            if (cfg->use_instr_cache) {
+                InstrCache& cache = InstrCache::Get();
+                if (cache.Lookup(cfg->arch, cur_addr, inst_buf, count, inst)) {
+                    ret = inst.len();
+                } else {
+                    ret = inst.DecodeFrom(cfg->arch, inst_buf, count, cur_addr);
+                    if (ret >= 0)
+                        cache.Insert(cfg->arch, inst, inst_buf);
+                }
+            } else {
+                ret = inst.DecodeFrom(cfg->arch, inst_buf, count, cur_addr);
+            }
+            if (ret < 0) // invalid or unknown instruction
+                break;
+
+            size_t instr_idx = instrs.size();
+            instrs.push_back(inst);
+            instr_map_entry->instr_idx = instr_idx;
+            instrs.SetBlockStart(instr_idx, new_block);
+            num_blocks += new_block;
+            code_min = std::min(code_min, cur_addr);
+            cur_addr += inst.len();
+            code_max = std::max(code_max, cur_addr);
             new_block = false;
 
             if (stop == DecodeStop::INSTR)
                 break;
 
-            auto [kind, jmp_target] = classifyInstr(cfg->arch, instr.inst);
+            auto [kind, jmp_target] = classifyInstr(cfg->arch, inst);
 
-            // For branches, enqueue jump target. NB: this doesn't include calls
-            if (jmp_target) {
+            // For branches, enqueue jump target. Call targets are only recorded
+            // as they belong to other functions.
+            if (kind == InstrKind::CALL) {
+                if (jmp_target && !llvm::is_contained(call_targets, jmp_target))
+                    call_targets.push_back(jmp_target);
+            } else if (jmp_target) {
                 auto& target_entry = instr_map.try_emplace(jmp_target).first->second;
                 target_entry.preds++;
-                if (!target_entry.decoded)
+                if (!target_entry.decoded())
                     addr_stack.push_back(jmp_target);
                 else
-                    instrs[target_entry.instr_idx].new_block = true;
+                    MarkBlockStart(target_entry.instr_idx);
             }
 
+            if (kind == InstrKind::BRANCH && !jmp_target && stop == DecodeStop::ALL)
+                DecodeJumpTable(first_idx, fetch, direct, addr_stack);
+
             if (kind == InstrKind::CALL && !cfg->call_function)
-                instr.inhibit_branch = true;
+                instrs.SetInhibitBranch(instr_idx);
 
             // End decoding stream if can't reach next instruction from here.
             if (kind == InstrKind::BRANCH || kind == InstrKind::UNKNOWN ||
@@ -231,4 +735,162 @@ int Function::Decode(uintptr_t addr, DecodeStop stop, MemReader memacc) {
     return 0;
 }
 
+size_t Function::FetchCached(uintptr_t addr, const uint8_t** buf,
+                             uint8_t* inst_buf, size_t inst_buf_sz,
+                             MemReader& memacc) {
+    size_t page_size = cfg->decode_page_size;
+    size_t count = 0;
+    while (count < inst_buf_sz) {
+        uint64_t cur_addr = addr + count;
+        uint64_t page_addr = cur_addr & ~uint64_t{page_size - 1};
+        auto [it, inserted] = page_cache.try_emplace(page_addr);
+        CachedPage& page = it->second;
+        if (inserted) {
+            page.data = std::make_unique<uint8_t[]>(page_size);
+            page.size = memacc(page_addr, page.data.get(), page_size);
+        }
+
+        size_t off = cur_addr - page_addr;
+        if (off >= page.size)
+            break;
+        size_t avail = std::min(page.size - off, inst_buf_sz - count);
+        // Common case: the instruction is entirely inside a single page.
+        if (count == 0 && avail == inst_buf_sz) {
+            *buf = page.data.get() + off;
+            return avail;
+        }
+        // Otherwise, assemble the bytes in inst_buf; only continue with the
+        // next page if this page was read entirely.
+        memcpy(inst_buf + count, page.data.get() + off, avail);
+        count += avail;
+        if (page.size != page_size)
+            break;
+    }
+    *buf = inst_buf;
+    return count;
+}
+
+int Function::Decode(uintptr_t addr, DecodeStop stop, MemReader memacc) {
+    uint8_t inst_buf[15];
+    if (!memacc) {
+        return DecodeImpl(addr, stop, [](uint64_t cur_addr, const uint8_t** buf) {
+            *buf = reinterpret_cast<const uint8_t*>(cur_addr);
+            return sizeof(inst_buf);
+        }, /*direct=*/true);
+    }
+    if (llvm::isPowerOf2_64(cfg->decode_page_size)) {
+        return DecodeImpl(addr, stop, [&](uint64_t cur_addr, const uint8_t** buf) {
+            return FetchCached(cur_addr, buf, inst_buf, sizeof(inst_buf), memacc);
+        });
+    }
+    return DecodeImpl(addr, stop, [&](uint64_t cur_addr, const uint8_t** buf) {
+        *buf = inst_buf;
+        return memacc(cur_addr, inst_buf, sizeof(inst_buf));
+    });
+}
+
+int Function::DecodeMore(uint64_t branch_addr, uintptr_t addr,
+                         MemReader memacc) {
+    if (!instrs.empty()) {
+        auto branch_it = instr_map.find(branch_addr);
+        if (branch_it == instr_map.end() || !branch_it->second.decoded())
+            return -1;
+        auto& targets = jump_tables[branch_addr];
+        if (!llvm::is_contained(targets, addr)) {
+            targets.push_back(addr);
+            instr_map[addr].preds++;
+        }
+    }
+    return Decode(addr, DecodeStop::ALL, std::move(memacc));
+}
+
+int Function::DecodeSpan(uintptr_t addr, DecodeStop stop, uintptr_t base_addr,
+                         const uint8_t* buf, size_t len) {
+    if (!buf || addr < base_addr || addr - base_addr >= len)
+        return -1;
+    return DecodeImpl(addr, stop, [=](uint64_t cur_addr, const uint8_t** inst) {
+        // Unsigned wrap-around also rejects addresses below base_addr.
+        uint64_t off = cur_addr - base_addr;
+        if (off >= len)
+            return size_t{0};
+        *inst = buf + off;
+        return std::min<size_t>(len - off, 15);
+    });
+}
+
+std::vector<uint8_t> Function::ComputeDeadFlags() const {
+    using FlagEffectsFn = std::pair<unsigned, unsigned>(const Instr&, const LLConfig&) noexcept;
+    FlagEffectsFn* flag_effects = nullptr;
+    switch (cfg->arch) {
+#ifdef RELLUME_WITH_X86_64
+    case Arch::X86_64: flag_effects = x86_64::InstrFlagEffects; break;
+#endif // RELLUME_WITH_X86_64
+    default:
+        return {};
+    }
+
+    // Backward liveness analysis on instruction level. Leaving the decoded
+    // code, indirect branches and calls keep all flags alive.
+    constexpr unsigned kAllFlags = 0x7f;
+    size_t count = instrs.size();
+    std::vector<uint8_t> uses(count), defs(count), live_in(count), live_out(count);
+    std::vector<std::array<uint32_t, 2>> succs(count);
+    std::vector<bool> exits(count);
+    for (size_t i = 0; i < count; i++) {
+        Instr inst = instrs[i];
+        std::tie(uses[i], defs[i]) = flag_effects(inst, *cfg);
+
+        auto succ_idx = [&](uint64_t addr) {
+            auto it = instr_map.find(addr);
+            if (it == instr_map.end() || !it->second.decoded())
+                exits[i] = true;
+            return it == instr_map.end() ? UINT32_MAX : it->second.instr_idx;
+        };
+        succs[i] = {UINT32_MAX, UINT32_MAX};
+        auto [kind, jmp_target] = classifyInstr(cfg->arch, inst);
+        if (instrs.InhibitsBranch(i))
+            kind = InstrKind::UNKNOWN;
+        switch (kind) {
+        case InstrKind::BRANCH:
+            if (jmp_target)
+                succs[i][0] = succ_idx(jmp_target);
+            else
+                exits[i] = true;
+            break;
+        case InstrKind::COND_BRANCH:
+            succs[i] = {succ_idx(jmp_target), succ_idx(inst.end())};
+            break;
+        case InstrKind::CALL:
+        case InstrKind::UNKNOWN:
+            exits[i] = true;
+            break;
+        case InstrKind::OTHER:
+            succs[i][0] = succ_idx(inst.end());
+            break;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = count; i-- > 0; ) {
+            unsigned out = exits[i] ? kAllFlags : 0;
+            for (uint32_t succ : succs[i])
+                if (succ != UINT32_MAX)
+                    out |= live_in[succ];
+            live_out[i] = out;
+            unsigned in = uses[i] | (out & ~defs[i]);
+            if (in != live_in[i]) {
+                live_in[i] = in;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<uint8_t> dead_flags(count);
+    for (size_t i = 0; i < count; i++)
+        dead_flags[i] = defs[i] & ~live_out[i];
+    return dead_flags;
+}
+
 } // namespace rellume
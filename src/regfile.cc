@@ -27,6 +27,7 @@
 #include "facet.h"
 
 #include <llvm-c/Core.h>
+#include <llvm/Support/Allocator.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/IRBuilder.h>
@@ -196,7 +197,7 @@ public:
             : irb(bb), dirty_regs() {
         switch (arch) {
 #ifdef RELLUME_WITH_X86_64
-        case Arch::X86_64: ivec_facet = Facet::V2I64; break;
+        case Arch::X86_64: ivec_facet = Facet::V4I64; break;
 #endif // RELLUME_WITH_X86_64
 #ifdef RELLUME_WITH_RV64
         case Arch::RV64: ivec_facet = Facet::I64; break;
@@ -243,6 +244,14 @@ public:
     }
     llvm::Value* GetPCValue(llvm::Value* pcBase, uint64_t pcBaseAddr, uint64_t offset);
     std::tuple<llvm::Value*, uint64_t, uint64_t> GetPCBranch(llvm::Value* pcBase, uint64_t pcBaseAddr);
+    uint64_t GetPCConst() {
+        return pc.mode == PCReg::Const ? pc.offset1 : 0;
+    }
+
+    void SetFlagCmp(llvm::Value* lhs, llvm::Value* rhs) {
+        flag_cmp = {lhs, rhs};
+    }
+    std::pair<llvm::Value*, llvm::Value*> GetFlagCmp() { return flag_cmp; }
 
     RegisterSet& DirtyRegs() { return dirty_regs; }
     bool StartsClean() { return !parent && !phiDescs; }
@@ -278,6 +287,9 @@ private:
 
     RegisterSet dirty_regs;
 
+    /// Operands of the comparison which set the flags, if still valid.
+    std::pair<llvm::Value*, llvm::Value*> flag_cmp{nullptr, nullptr};
+
     Register* AccessReg(ArchReg reg);
     Facet NativeFacet(ArchReg reg);
 
@@ -495,6 +507,7 @@ llvm::Value* RegFile::impl::GetReg(ArchReg reg, Facet facet) {
         val = irb.CreateZExtOrTrunc(val, irb.getIntNTy(facetSize));
         return irb.CreatePointerCast(val, facetType);
     }
+    case Facet::I256:
     case Facet::I128:
     case Facet::I64:
     case Facet::I32:
@@ -570,6 +583,8 @@ void RegFile::impl::Set(ArchReg reg, llvm::Value* value, bool sext) {
     assert(!sext && "sign-extension to full not implemented");
     *AccessReg(reg) = Register(/*upperZero=*/true, value);
     dirty_regs[RegisterSetBitIdx(reg)] = true;
+    if (reg.Kind() == ArchReg::RegKind::FLAG)
+        flag_cmp = {nullptr, nullptr};
 }
 
 void RegFile::impl::Merge(ArchReg reg, llvm::Value* value) {
@@ -587,12 +602,16 @@ void RegFile::impl::Merge(ArchReg reg, llvm::Value* value) {
     rv->values.push_back(Register::Value(value, size));
 
     dirty_regs[RegisterSetBitIdx(reg)] = true;
+    if (reg.Kind() == ArchReg::RegKind::FLAG)
+        flag_cmp = {nullptr, nullptr};
 }
 
 void RegFile::impl::Set(ArchReg reg, Transform transform, llvm::Value* v1,
                         llvm::Value* v2, llvm::Value* v3) {
     *AccessReg(reg) = Register(transform, v1, v2, v3);
     dirty_regs[RegisterSetBitIdx(reg)] = true;
+    if (reg.Kind() == ArchReg::RegKind::FLAG)
+        flag_cmp = {nullptr, nullptr};
 }
 
 llvm::Value* RegFile::impl::GetPCValue(llvm::Value* pcBase, uint64_t pcBaseAddr, uint64_t offset) {
@@ -632,8 +651,19 @@ std::tuple<llvm::Value*, uint64_t, uint64_t> RegFile::impl::GetPCBranch(llvm::Va
     }
 }
 
-RegFile::RegFile(Arch arch, llvm::BasicBlock* bb) : pimpl{std::make_unique<impl>(arch, bb)} {}
-RegFile::~RegFile() {}
+class RegFile::Arena::impl {
+public:
+    llvm::SpecificBumpPtrAllocator<RegFile::impl> impls;
+    llvm::SpecificBumpPtrAllocator<RegFile> regfiles;
+};
+
+RegFile::Arena::Arena() : pimpl{std::make_unique<impl>()} {}
+RegFile::Arena::~Arena() {}
+
+RegFile* RegFile::Arena::Create(Arch arch, llvm::BasicBlock* bb) {
+    auto rf_impl = new (pimpl->impls.Allocate()) RegFile::impl(arch, bb);
+    return new (pimpl->regfiles.Allocate()) RegFile(rf_impl);
+}
 
 llvm::BasicBlock* RegFile::GetInsertBlock() { return pimpl->GetInsertBlock(); }
 void RegFile::SetInsertPoint(llvm::BasicBlock::iterator ip) { pimpl->SetInsertPoint(ip); }
@@ -665,9 +695,18 @@ void RegFile::SetPCCallret(llvm::Value* addr, uint64_t check) {
 std::tuple<llvm::Value*, uint64_t, uint64_t> RegFile::GetPCBranch(llvm::Value* pcBase, uint64_t pcBaseAddr) {
     return pimpl->GetPCBranch(pcBase, pcBaseAddr);
 }
+uint64_t RegFile::GetPCConst() {
+    return pimpl->GetPCConst();
+}
 llvm::Value* RegFile::GetPCValue(llvm::Value* pcBase, uint64_t pcBaseAddr, uint64_t offset) {
     return pimpl->GetPCValue(pcBase, pcBaseAddr, offset);
 }
+void RegFile::SetFlagCmp(llvm::Value* lhs, llvm::Value* rhs) {
+    pimpl->SetFlagCmp(lhs, rhs);
+}
+std::pair<llvm::Value*, llvm::Value*> RegFile::GetFlagCmp() {
+    return pimpl->GetFlagCmp();
+}
 RegisterSet& RegFile::DirtyRegs() { return pimpl->DirtyRegs(); }
 bool RegFile::StartsClean() { return pimpl->StartsClean(); }
 
@@ -32,6 +32,7 @@
 #include <llvm/IR/Value.h>
 
 #include <bitset>
+#include <memory>
 #include <tuple>
 #include <vector>
 
@@ -117,11 +118,19 @@ unsigned RegisterSetBitIdx(ArchReg reg);
 
 class RegFile {
 public:
-    RegFile(Arch arch, llvm::BasicBlock* bb);
-    ~RegFile();
-
-    RegFile(RegFile&& rhs);
-    RegFile& operator=(RegFile&& rhs);
+    /// Allocator for the register files of a single lifted function. All
+    /// register files are freed at once when the arena is destroyed.
+    class Arena {
+    public:
+        Arena();
+        ~Arena();
+
+        RegFile* Create(Arch arch, llvm::BasicBlock* bb);
+
+    private:
+        class impl;
+        std::unique_ptr<impl> pimpl;
+    };
 
     RegFile(const RegFile&) = delete;
     RegFile& operator=(const RegFile&) = delete;
@@ -163,6 +172,15 @@ public:
     llvm::Value* GetPCValue(llvm::Value* pcBase, uint64_t pcBaseAddr, uint64_t offset = 0);
     /// Tuple of branch cond (or null), then addr (or 0), else addr (or 0)
     std::tuple<llvm::Value*, uint64_t, uint64_t> GetPCBranch(llvm::Value* pcBase, uint64_t pcBaseAddr);
+    /// Address if the PC is a known constant, or zero
+    uint64_t GetPCConst();
+
+    /// Record that the status flags were computed from comparing lhs and rhs,
+    /// so that conditions can be lifted as a single comparison. Any later
+    /// modification of a flag discards the record.
+    void SetFlagCmp(llvm::Value* lhs, llvm::Value* rhs);
+    /// Operands of the comparison that set the flags, or null.
+    std::pair<llvm::Value*, llvm::Value*> GetFlagCmp();
 
     /// Modified registers not yet recorded in a CallConvPack in the FunctionInfo.
     RegisterSet& DirtyRegs();
@@ -170,7 +188,9 @@ public:
 
 private:
     class impl;
-    std::unique_ptr<impl> pimpl;
+    impl* pimpl;
+
+    RegFile(impl* pimpl) : pimpl(pimpl) {}
 };
 
 } // namespace rellume
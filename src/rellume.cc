@@ -27,6 +27,7 @@
 #include "config.h"
 #include "function.h"
 #include "instr.h"
+#include "instr-cache.h"
 
 #include <llvm-c/Core.h>
 #include <llvm/IR/Module.h>
@@ -61,6 +62,9 @@ void ll_config_enable_fast_math(LLConfig* cfg, bool enable) {
 void ll_config_enable_verify_ir(LLConfig* cfg, bool enable) {
     unwrap(cfg)->verify_ir = enable;
 }
+void ll_config_enable_stack_promotion(LLConfig* cfg, bool enable) {
+    unwrap(cfg)->promote_stack_slots = enable;
+}
 void ll_config_set_position_independent_code(LLConfig* cfg, bool enable) {
     unwrap(cfg)->position_independent_code = enable;
 }
@@ -101,9 +105,30 @@ void ll_config_set_instr_marker(LLConfig* cfg, LLVMValueRef value) {
 void ll_config_set_call_ret_clobber_flags(LLConfig* cfg, bool enable) {
     unwrap(cfg)->call_ret_clobber_flags = enable;
 }
+void ll_config_set_call_preserve_callee_saved(LLConfig* cfg, bool enable) {
+    unwrap(cfg)->call_preserve_callee_saved = enable;
+}
+void ll_config_set_decode_page_size(LLConfig* cfg, size_t page_size) {
+    unwrap(cfg)->decode_page_size = page_size;
+}
+void ll_config_set_decode_budget(LLConfig* cfg, size_t max_instrs,
+                                 size_t max_blocks, uint64_t max_span) {
+    unwrap(cfg)->decode_max_instrs = max_instrs;
+    unwrap(cfg)->decode_max_blocks = max_blocks;
+    unwrap(cfg)->decode_max_span = max_span;
+}
+void ll_config_enable_instr_cache(LLConfig* cfg, bool enable) {
+    unwrap(cfg)->use_instr_cache = enable;
+}
 void ll_config_set_use_native_segment_base(LLConfig* cfg, bool enable) {
     unwrap(cfg)->use_native_segment_base = enable;
 }
+void ll_config_set_use_native_bmi2(LLConfig* cfg, bool enable) {
+    unwrap(cfg)->use_native_bmi2 = enable;
+}
+void ll_config_set_use_native_crypto(LLConfig* cfg, bool enable) {
+    unwrap(cfg)->use_native_crypto = enable;
+}
 void ll_config_enable_full_facets(LLConfig* cfg, bool enable) {
 }
 bool ll_config_set_architecture(LLConfig* cfg, const char *s) {
@@ -129,6 +154,39 @@ bool ll_config_set_architecture(LLConfig* cfg, const char *s) {
     return false;
 }
 
+bool ll_config_set_register_callconv(LLConfig* cfg, bool enable) {
+    rellume::LLConfig* rl_cfg = unwrap(cfg);
+    rellume::CallConv cconv = enable
+            ? rellume::CallConv::RegisterPassing(rl_cfg->arch)
+            : rellume::CallConv::Sptr(rl_cfg->arch);
+    if (cconv == rellume::CallConv::INVALID)
+        return false;
+    rl_cfg->callconv = cconv;
+    return true;
+}
+
+void ll_config_set_lifted_func(LLConfig* cfg, uintptr_t addr,
+                               LLVMValueRef fn) {
+    if (fn)
+        unwrap(cfg)->lifted_functions[addr] = llvm::unwrap<llvm::Function>(fn);
+    else
+        unwrap(cfg)->lifted_functions.erase(addr);
+}
+LLVMValueRef ll_config_get_lifted_func(LLConfig* cfg, uintptr_t addr) {
+    auto& lifted_functions = unwrap(cfg)->lifted_functions;
+    auto it = lifted_functions.find(addr);
+    return it != lifted_functions.end() ? llvm::wrap(it->second) : nullptr;
+}
+
+void ll_config_add_ro_range(LLConfig* cfg, uintptr_t start, uintptr_t end) {
+    unwrap(cfg)->ro_mem_ranges.emplace_back(start, end);
+}
+void ll_config_set_ro_mem_reader(LLConfig* cfg, RellumeMemAccessCb cb,
+                                 void* user_arg) {
+    unwrap(cfg)->ro_mem_read = cb;
+    unwrap(cfg)->ro_mem_read_arg = user_arg;
+}
+
 // Rellume Function API
 
 LLFunc* ll_func_new(LLVMModuleRef mod, LLConfig* cfg) {
@@ -147,11 +205,6 @@ static int ll_func_decode(LLFunc* func, uintptr_t addr,
         rl_memacc = [=](uintptr_t maddr, uint8_t* buf, size_t buf_sz) {
             return mem_acc(maddr, buf, buf_sz, user_arg);
         };
-    } else {
-        rl_memacc = [](uintptr_t mem_addr, uint8_t* buf, size_t buf_sz) {
-            memcpy(buf, reinterpret_cast<uint8_t*>(mem_addr), buf_sz);
-            return buf_sz;
-        };
     }
     return unwrap(func)->Decode(addr, stop, rl_memacc);
 }
@@ -171,6 +224,42 @@ int ll_func_decode_cfg(LLFunc* func, uintptr_t addr, RellumeMemAccessCb mem_acc,
                           mem_acc, user_arg);
 }
 
+int ll_func_decode_more(LLFunc* func, uintptr_t branch_addr, uintptr_t addr,
+                        RellumeMemAccessCb mem_acc, void* user_arg) {
+    rellume::Function::MemReader rl_memacc;
+    if (mem_acc) {
+        rl_memacc = [=](uintptr_t maddr, uint8_t* buf, size_t buf_sz) {
+            return mem_acc(maddr, buf, buf_sz, user_arg);
+        };
+    }
+    return unwrap(func)->DecodeMore(branch_addr, addr, rl_memacc);
+}
+
+int ll_func_decode_instr_span(LLFunc* func, uintptr_t base_addr,
+                              const uint8_t* buf, size_t len, uintptr_t addr) {
+    return unwrap(func)->DecodeSpan(addr, rellume::Function::DecodeStop::INSTR,
+                                    base_addr, buf, len);
+}
+int ll_func_decode_block_span(LLFunc* func, uintptr_t base_addr,
+                              const uint8_t* buf, size_t len, uintptr_t addr) {
+    return unwrap(func)->DecodeSpan(addr,
+                                    rellume::Function::DecodeStop::BASICBLOCK,
+                                    base_addr, buf, len);
+}
+int ll_func_decode_cfg_span(LLFunc* func, uintptr_t base_addr,
+                            const uint8_t* buf, size_t len, uintptr_t addr) {
+    return unwrap(func)->DecodeSpan(addr, rellume::Function::DecodeStop::ALL,
+                                    base_addr, buf, len);
+}
+
+void ll_instr_cache_invalidate(uintptr_t start, uintptr_t end) {
+    rellume::InstrCache::Get().Invalidate(start, end);
+}
+
+bool ll_func_is_partial(LLFunc* func) {
+    return unwrap(func)->IsPartial();
+}
+
 const struct RellumeCodeRange* ll_func_ranges(LLFunc* func) {
     return reinterpret_cast<const RellumeCodeRange*>(unwrap(func)->CodeRanges());
 }
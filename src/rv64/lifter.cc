@@ -106,12 +106,19 @@ public:
     }
     void LiftLoad(const FrvInst* rvi, llvm::Instruction::CastOps ext, Facet f) {
         llvm::Type* ty = f.Type(irb.getContext());
-        llvm::Value* ld = irb.CreateLoad(ty, Addr(rvi));
+        llvm::Value* addr = Addr(rvi);
+        llvm::Value* ld = LoadReadOnly(ty, addr);
+        if (!ld)
+            ld = irb.CreateLoad(ty, addr);
         StoreGp(rvi->rd, irb.CreateCast(ext, ld, irb.getInt64Ty()));
     }
     void LiftLoadFp(const FrvInst* rvi, Facet f) {
         llvm::Type* ty = f.Type(irb.getContext());
-        StoreFp(rvi->rd, irb.CreateLoad(ty, Addr(rvi)));
+        llvm::Value* addr = Addr(rvi);
+        llvm::Value* ld = LoadReadOnly(ty, addr);
+        if (!ld)
+            ld = irb.CreateLoad(ty, addr);
+        StoreFp(rvi->rd, ld);
     }
     void LiftStore(const FrvInst* rvi, Facet f) {
         irb.CreateStore(LoadGp(rvi->rs2, f), Addr(rvi));
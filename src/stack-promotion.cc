@@ -0,0 +1,320 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file
+ **/
+
+#include "stack-promotion.h"
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Operator.h>
+#include <algorithm>
+#include <cstdint>
+
+
+namespace rellume {
+
+ArchReg StackPointerReg(Arch arch) {
+    switch (arch) {
+#ifdef RELLUME_WITH_X86_64
+    case Arch::X86_64: return ArchReg::RSP;
+#endif // RELLUME_WITH_X86_64
+#ifdef RELLUME_WITH_RV64
+    case Arch::RV64: return ArchReg::GP(2);
+#endif // RELLUME_WITH_RV64
+#ifdef RELLUME_WITH_AARCH64
+    case Arch::AArch64: return ArchReg::A64_SP;
+#endif // RELLUME_WITH_AARCH64
+    default: return ArchReg();
+    }
+}
+
+namespace {
+
+class StackFrameAnalysis {
+    const llvm::DataLayout& dl;
+
+    /// Offset to the entry stack pointer for all values derived from it.
+    llvm::DenseMap<llvm::Value*, int64_t> offsets;
+    /// PHI nodes and selects, whose incoming values must all be derived from
+    /// the stack pointer with the same offset.
+    llvm::SmallVector<llvm::Instruction*, 16> merges;
+
+    struct Access {
+        llvm::Instruction* inst;
+        int64_t off;
+        uint64_t size;
+    };
+    llvm::SmallVector<Access, 32> accesses;
+
+    bool Visit(llvm::Value* val, int64_t off,
+               llvm::SmallVectorImpl<llvm::Value*>& worklist);
+    static bool OnlyReturned(llvm::Value* val);
+
+public:
+    /// Maximum size of a promoted frame.
+    static constexpr int64_t kMaxFrameSize = 4096;
+
+    StackFrameAnalysis(const llvm::DataLayout& dl) : dl(dl) {}
+
+    bool Analyze(llvm::Function* fn, llvm::Value* entry_sp);
+    /// Size of the frame, aligned to 16 bytes; zero if there is nothing to
+    /// promote.
+    int64_t FrameSize() const;
+    /// Offset of a value to the entry stack pointer, if known.
+    bool Offset(llvm::Value* val, int64_t* off) const;
+    llvm::ArrayRef<Access> Accesses() const { return accesses; }
+};
+
+/// Whether val ends up only in return values, i.e. leaves at an exit.
+bool StackFrameAnalysis::OnlyReturned(llvm::Value* val) {
+    for (llvm::User* user : val->users()) {
+        if (llvm::isa<llvm::ReturnInst>(user))
+            continue;
+        if (!llvm::isa<llvm::InsertValueInst>(user) || !OnlyReturned(user))
+            return false;
+    }
+    return true;
+}
+
+bool StackFrameAnalysis::Visit(llvm::Value* val, int64_t off,
+                               llvm::SmallVectorImpl<llvm::Value*>& worklist) {
+    for (llvm::User* user : val->users()) {
+        auto inst = llvm::dyn_cast<llvm::Instruction>(user);
+        if (!inst)
+            return false;
+
+        int64_t derived_off;
+        switch (inst->getOpcode()) {
+        case llvm::Instruction::Add:
+        case llvm::Instruction::Sub: {
+            auto cst = llvm::dyn_cast<llvm::ConstantInt>(inst->getOperand(1));
+            bool is_add = inst->getOpcode() == llvm::Instruction::Add;
+            if (is_add && !cst) {
+                cst = llvm::dyn_cast<llvm::ConstantInt>(inst->getOperand(0));
+            } else if (inst->getOperand(0) != val) {
+                return false;
+            }
+            if (!cst || inst->getType()->getIntegerBitWidth() != 64)
+                return false;
+            int64_t cst_val = cst->getSExtValue();
+            derived_off = is_add ? off + cst_val : off - cst_val;
+            break;
+        }
+        case llvm::Instruction::IntToPtr:
+        case llvm::Instruction::PtrToInt:
+            if (dl.getTypeSizeInBits(inst->getType()) != 64)
+                return false;
+            derived_off = off;
+            break;
+        case llvm::Instruction::GetElementPtr: {
+            auto gep = llvm::cast<llvm::GEPOperator>(inst);
+            llvm::APInt gep_off(64, 0);
+            if (gep->getPointerOperand() != val ||
+                !gep->accumulateConstantOffset(dl, gep_off))
+                return false;
+            derived_off = off + gep_off.getSExtValue();
+            break;
+        }
+        case llvm::Instruction::Select:
+            if (inst->getOperand(0) == val)
+                return false;
+            [[fallthrough]];
+        case llvm::Instruction::PHI:
+            merges.push_back(inst);
+            derived_off = off;
+            break;
+        case llvm::Instruction::ICmp:
+            continue;
+        case llvm::Instruction::Load: {
+            auto load = llvm::cast<llvm::LoadInst>(inst);
+            if (!load->isSimple())
+                return false;
+            uint64_t size = dl.getTypeStoreSize(load->getType());
+            accesses.push_back(Access{load, off, size});
+            continue;
+        }
+        case llvm::Instruction::Store: {
+            auto store = llvm::cast<llvm::StoreInst>(inst);
+            if (!store->isSimple())
+                return false;
+            // The stack pointer can only be stored into the CPU struct, which
+            // happens at exits only.
+            if (store->getValueOperand() == val) {
+                llvm::Value* obj = llvm::getUnderlyingObject(store->getPointerOperand());
+                if (!llvm::isa<llvm::Argument>(obj))
+                    return false;
+                continue;
+            }
+            llvm::Type* ty = store->getValueOperand()->getType();
+            accesses.push_back(Access{store, off, dl.getTypeStoreSize(ty)});
+            continue;
+        }
+        case llvm::Instruction::InsertValue:
+            if (!OnlyReturned(inst))
+                return false;
+            continue;
+        case llvm::Instruction::Call: {
+            // Tail calls are exits.
+            auto call = llvm::cast<llvm::CallInst>(inst);
+            if (!call->isMustTailCall() || call->getCalledOperand() == val)
+                return false;
+            continue;
+        }
+        default:
+            return false;
+        }
+
+        auto [it, inserted] = offsets.try_emplace(inst, derived_off);
+        if (inserted)
+            worklist.push_back(inst);
+        else if (it->second != derived_off)
+            return false;
+    }
+    return true;
+}
+
+bool StackFrameAnalysis::Analyze(llvm::Function* fn, llvm::Value* entry_sp) {
+    // Other functions might access the frame through the stack pointer in the
+    // CPU struct, so bail out if anything except intrinsics is called before
+    // leaving the function.
+    for (llvm::Instruction& inst : llvm::instructions(fn)) {
+        auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+        if (call && !call->isMustTailCall() &&
+            !llvm::isa<llvm::IntrinsicInst>(call))
+            return false;
+    }
+
+    llvm::SmallVector<llvm::Value*, 32> worklist;
+    offsets[entry_sp] = 0;
+    worklist.push_back(entry_sp);
+    while (!worklist.empty()) {
+        llvm::Value* val = worklist.pop_back_val();
+        if (!Visit(val, offsets.lookup(val), worklist))
+            return false;
+    }
+
+    for (llvm::Instruction* merge : merges) {
+        int64_t merge_off = offsets.lookup(merge);
+        unsigned first_op = llvm::isa<llvm::SelectInst>(merge) ? 1 : 0;
+        for (unsigned i = first_op; i < merge->getNumOperands(); i++) {
+            int64_t incoming_off;
+            if (!Offset(merge->getOperand(i), &incoming_off) ||
+                incoming_off != merge_off)
+                return false;
+        }
+    }
+
+    // Frame accesses must not extend beyond the entry stack pointer.
+    for (const Access& access : accesses)
+        if (access.off < 0 && access.off + int64_t(access.size) > 0)
+            return false;
+    return true;
+}
+
+int64_t StackFrameAnalysis::FrameSize() const {
+    int64_t min_off = 0;
+    for (const Access& access : accesses)
+        min_off = std::min(min_off, access.off);
+    int64_t size = (-min_off + 15) & ~int64_t{15};
+    return size <= kMaxFrameSize ? size : 0;
+}
+
+bool StackFrameAnalysis::Offset(llvm::Value* val, int64_t* off) const {
+    auto it = offsets.find(val);
+    if (it == offsets.end())
+        return false;
+    *off = it->second;
+    return true;
+}
+
+} // end anonymous namespace
+
+bool PromoteStackSlots(llvm::Function* fn, llvm::Value* entry_sp,
+        const llvm::DenseMap<llvm::BasicBlock*, llvm::WeakTrackingVH>& exit_sps) {
+    StackFrameAnalysis analysis(fn->getParent()->getDataLayout());
+    if (!analysis.Analyze(fn, entry_sp))
+        return false;
+    int64_t frame_size = analysis.FrameSize();
+    if (!frame_size)
+        return false;
+
+    llvm::BasicBlock& entry = fn->getEntryBlock();
+    llvm::IRBuilder<> irb(&entry, entry.getFirstInsertionPt());
+    llvm::Type* frame_ty = llvm::ArrayType::get(irb.getInt8Ty(), frame_size);
+    llvm::AllocaInst* frame = irb.CreateAlloca(frame_ty);
+    frame->setAlignment(llvm::Align(16));
+
+    // Copy the frame from memory, unused parts are removed by SROA.
+    if (auto sp_inst = llvm::dyn_cast<llvm::Instruction>(entry_sp))
+        irb.SetInsertPoint(sp_inst->getNextNode());
+    llvm::Value* frame_addr = irb.CreateSub(entry_sp, irb.getInt64(frame_size));
+    llvm::Value* mem_frame = irb.CreateIntToPtr(frame_addr, irb.getPtrTy());
+    irb.CreateMemCpy(frame, frame->getAlign(), mem_frame, llvm::Align(1),
+                     frame_size);
+
+    for (const auto& access : analysis.Accesses()) {
+        if (access.off >= 0)
+            continue;
+        irb.SetInsertPoint(access.inst);
+        llvm::Value* slot = irb.CreateConstInBoundsGEP1_64(irb.getInt8Ty(),
+                frame, access.off + frame_size);
+        if (auto load = llvm::dyn_cast<llvm::LoadInst>(access.inst))
+            load->setOperand(load->getPointerOperandIndex(), slot);
+        else
+            access.inst->setOperand(llvm::StoreInst::getPointerOperandIndex(), slot);
+    }
+
+    // Write back the frame where it might still be live. Once the stack
+    // pointer is above the entry stack pointer, e.g. after a return, the
+    // frame is deallocated and dead.
+    for (llvm::BasicBlock& bb : *fn) {
+        auto ret = llvm::dyn_cast<llvm::ReturnInst>(bb.getTerminator());
+        if (!ret)
+            continue;
+        auto exit_sp_it = exit_sps.find(&bb);
+        int64_t exit_off;
+        if (exit_sp_it != exit_sps.end() && exit_sp_it->second &&
+            analysis.Offset(exit_sp_it->second, &exit_off) && exit_off > 0)
+            continue;
+
+        llvm::Instruction* pos = ret;
+        if (llvm::CallInst* call = bb.getTerminatingMustTailCall())
+            pos = call;
+        irb.SetInsertPoint(pos);
+        irb.CreateMemCpy(mem_frame, llvm::Align(1), frame, frame->getAlign(),
+                         frame_size);
+    }
+
+    return true;
+}
+
+} // namespace rellume
@@ -0,0 +1,58 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file
+ **/
+
+#ifndef RELLUME_STACK_PROMOTION_H
+#define RELLUME_STACK_PROMOTION_H
+
+#include "arch.h"
+#include "regfile.h"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/ValueHandle.h>
+
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Value;
+}
+
+namespace rellume {
+
+/// Stack pointer register of the architecture.
+ArchReg StackPointerReg(Arch arch);
+
+/// Move the stack frame below the stack pointer at function entry, entry_sp,
+/// into an alloca, so that spills and locals become SSA values. This is only
+/// done if the stack pointer does not escape and all frame accesses have
+/// constant offsets. The frame is read from memory on entry and written back
+/// before returning, except from blocks in exit_sps whose stack pointer is
+/// known to be above the entry stack pointer. Returns whether the function
+/// was changed.
+bool PromoteStackSlots(llvm::Function* fn, llvm::Value* entry_sp,
+        const llvm::DenseMap<llvm::BasicBlock*, llvm::WeakTrackingVH>& exit_sps);
+
+} // namespace rellume
+
+#endif
@@ -0,0 +1,445 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include "x86-64/lifter-private.h"
+
+#include "facet.h"
+#include "instr.h"
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Value.h>
+
+/**
+ * \defgroup LLInstructionAVX AVX Instructions
+ * \ingroup LLInstruction
+ *
+ * VEX-encoded instructions have a separate destination operand and clear all
+ * bits of the destination register above the result, see OpStoreVex.
+ *
+ * @{
+ **/
+
+namespace rellume::x86_64 {
+
+llvm::Value* Lifter::AvxScalarMerge(const Instr& inst, llvm::Value* scalar) {
+    // Scalar operations copy the upper elements from the first source.
+    llvm::Type* el_ty = scalar->getType();
+    unsigned cnt = 128 / el_ty->getPrimitiveSizeInBits();
+    llvm::Value* src1 = OpLoad(inst.op(1), Facet::Vnt(cnt, Facet::FromType(el_ty)));
+    return irb.CreateInsertElement(src1, scalar, uint64_t{0});
+}
+
+void Lifter::LiftAvxZeroupper(const Instr& inst) {
+    for (unsigned i = 0; i < 16; i++) {
+        if (inst.type() == FDI_VZEROALL) {
+            SetReg(ArchReg::VEC(i), llvm::Constant::getNullValue(
+                                        Facet{Facet::V4I64}.Type(irb.getContext())));
+        } else {
+            SetReg(ArchReg::VEC(i), GetReg(ArchReg::VEC(i), Facet::V2I64));
+        }
+    }
+}
+
+void Lifter::LiftAvxMov(const Instr& inst, Facet facet, Alignment alignment) {
+    OpStoreVex(inst.op(0), OpLoad(inst.op(1), facet, alignment), alignment);
+}
+
+void Lifter::LiftAvxMovq(const Instr& inst, Facet type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), type);
+    if (inst.op(0).is_reg() && inst.op(0).reg().rt == FD_RT_VEC)
+        OpStoreVex(inst.op(0), op1);
+    else
+        OpStoreGp(inst.op(0), op1);
+}
+
+void Lifter::LiftAvxMovScalar(const Instr& inst, Facet facet) {
+    if (inst.op(2)) {
+        // Register form, the upper elements come from the first source.
+        llvm::Value* src = OpLoad(inst.op(2), facet);
+        OpStoreVex(inst.op(0), AvxScalarMerge(inst, src));
+    } else {
+        // Loads clear the register above the scalar, stores write the scalar.
+        OpStoreVex(inst.op(0), OpLoad(inst.op(1), facet));
+    }
+}
+
+void Lifter::LiftAvxBinOp(const Instr& inst, llvm::Instruction::BinaryOps op,
+                          Facet op_type) {
+    if (op == llvm::Instruction::Xor && inst.op(1).is_reg() &&
+        inst.op(2).is_reg() && inst.op(1).reg().ri == inst.op(2).reg().ri) {
+        auto ty = op_type.Resolve(inst.op(0).bits()).Type(irb.getContext());
+        OpStoreVex(inst.op(0), llvm::Constant::getNullValue(ty));
+        return;
+    }
+
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    llvm::Value* res = irb.CreateBinOp(op, op1, op2);
+    if (!res->getType()->isVectorTy())
+        res = AvxScalarMerge(inst, res);
+    OpStoreVex(inst.op(0), res);
+}
+
+void Lifter::LiftAvxAndn(const Instr& inst, Facet op_type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    OpStoreVex(inst.op(0), irb.CreateAnd(irb.CreateNot(op1), op2));
+}
+
+void Lifter::LiftAvxMinmax(const Instr& inst, llvm::CmpInst::Predicate pred,
+                           Facet op_type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    llvm::Value* cmp = irb.CreateFCmp(pred, op1, op2);
+    llvm::Value* res = irb.CreateSelect(cmp, op1, op2);
+    if (!res->getType()->isVectorTy())
+        res = AvxScalarMerge(inst, res);
+    OpStoreVex(inst.op(0), res);
+}
+
+void Lifter::LiftAvxSqrt(const Instr& inst, Facet op_type) {
+    if (inst.op(2)) {
+        llvm::Value* src = OpLoad(inst.op(2), op_type);
+        llvm::Value* res = irb.CreateUnaryIntrinsic(llvm::Intrinsic::sqrt, src);
+        OpStoreVex(inst.op(0), AvxScalarMerge(inst, res));
+    } else {
+        llvm::Value* src = OpLoad(inst.op(1), op_type);
+        OpStoreVex(inst.op(0), irb.CreateUnaryIntrinsic(llvm::Intrinsic::sqrt, src));
+    }
+}
+
+void Lifter::LiftAvxCmp(const Instr& inst, Facet op_type) {
+    // Predicates 16-31 only differ from 0-15 in signalling QNaNs.
+    static const llvm::FCmpInst::Predicate preds[16] = {
+        llvm::FCmpInst::FCMP_OEQ,   // EQ_OQ
+        llvm::FCmpInst::FCMP_OLT,   // LT_OS
+        llvm::FCmpInst::FCMP_OLE,   // LE_OS
+        llvm::FCmpInst::FCMP_UNO,   // UNORD_Q
+        llvm::FCmpInst::FCMP_UNE,   // NEQ_UQ
+        llvm::FCmpInst::FCMP_UGE,   // NLT_US
+        llvm::FCmpInst::FCMP_UGT,   // NLE_US
+        llvm::FCmpInst::FCMP_ORD,   // ORD_Q
+        llvm::FCmpInst::FCMP_UEQ,   // EQ_UQ
+        llvm::FCmpInst::FCMP_ULT,   // NGE_US
+        llvm::FCmpInst::FCMP_ULE,   // NGT_US
+        llvm::FCmpInst::FCMP_FALSE, // FALSE_OQ
+        llvm::FCmpInst::FCMP_ONE,   // NEQ_OQ
+        llvm::FCmpInst::FCMP_OGE,   // GE_OS
+        llvm::FCmpInst::FCMP_OGT,   // GT_OS
+        llvm::FCmpInst::FCMP_TRUE,  // TRUE_UQ
+    };
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    llvm::Value* cmp = irb.CreateFCmp(preds[inst.op(3).imm() & 0xf], op1, op2);
+    llvm::Type* cmp_ty = op1->getType();
+    if (cmp_ty->isVectorTy()) {
+        auto res_ty = llvm::VectorType::getInteger(llvm::cast<llvm::VectorType>(cmp_ty));
+        OpStoreVex(inst.op(0), irb.CreateSExt(cmp, res_ty));
+    } else {
+        auto res_ty = irb.getIntNTy(cmp_ty->getScalarSizeInBits());
+        OpStoreVex(inst.op(0), AvxScalarMerge(inst, irb.CreateSExt(cmp, res_ty)));
+    }
+}
+
+void Lifter::LiftAvxCvt(const Instr& inst, Facet src_type, Facet dst_type) {
+    llvm::Value* src = OpLoad(inst.op(1), src_type);
+    dst_type = dst_type.Resolve(inst.op(0).bits());
+    llvm::Type* dst_ty = dst_type.Type(irb.getContext());
+    auto cast_op = llvm::CastInst::getCastOpcode(src, true, dst_ty, true);
+    OpStoreVex(inst.op(0), irb.CreateCast(cast_op, src, dst_ty));
+}
+
+void Lifter::LiftAvxPcmp(const Instr& inst, llvm::CmpInst::Predicate pred,
+                         Facet op_type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    llvm::Value* cmp = irb.CreateICmp(pred, op1, op2);
+    OpStoreVex(inst.op(0), irb.CreateSExt(cmp, op1->getType()));
+}
+
+void Lifter::LiftAvxPminmax(const Instr& inst, llvm::CmpInst::Predicate pred,
+                            Facet op_type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    llvm::Value* cmp = irb.CreateICmp(pred, op1, op2);
+    OpStoreVex(inst.op(0), irb.CreateSelect(cmp, op1, op2));
+}
+
+void Lifter::LiftAvxPabs(const Instr& inst, Facet type) {
+    llvm::Value* src = OpLoad(inst.op(1), type);
+    llvm::Value* zero = llvm::Constant::getNullValue(src->getType());
+    llvm::Value* cmp = irb.CreateICmpSGE(src, zero);
+    OpStoreVex(inst.op(0), irb.CreateSelect(cmp, src, irb.CreateNeg(src)));
+}
+
+void Lifter::LiftAvxPmuldq(const Instr& inst, llvm::Instruction::CastOps ext) {
+    llvm::Value* src1 = OpLoad(inst.op(1), Facet::VI32);
+    llvm::Value* src2 = OpLoad(inst.op(2), Facet::VI32);
+
+    // Multiply the even elements.
+    unsigned cnt = VectorElementCount(src1->getType()) / 2;
+    llvm::SmallVector<int, 4> mask;
+    for (unsigned i = 0; i < cnt; i++)
+        mask.push_back(2 * i);
+    llvm::Type* ext_ty = llvm::VectorType::get(irb.getInt64Ty(), cnt, false);
+    src1 = irb.CreateCast(ext, irb.CreateShuffleVector(src1, src1, mask), ext_ty);
+    src2 = irb.CreateCast(ext, irb.CreateShuffleVector(src2, src2, mask), ext_ty);
+    OpStoreVex(inst.op(0), irb.CreateMul(src1, src2));
+}
+
+llvm::Value* Lifter::AvxShift(llvm::Instruction::BinaryOps op,
+                              llvm::Value* src, llvm::Value* shift) {
+    llvm::Type* vec_ty = src->getType();
+    unsigned elem_size = vec_ty->getScalarSizeInBits();
+    unsigned elem_cnt = VectorElementCount(vec_ty);
+    llvm::Value* size = irb.CreateVectorSplat(elem_cnt,
+                                              irb.getIntN(elem_size, elem_size));
+
+    // For arithmetical shifts, if shift >= elem_size, result is sign bit.
+    if (op == llvm::Instruction::AShr) {
+        llvm::Value* max = irb.CreateSub(size, llvm::ConstantInt::get(vec_ty, 1));
+        shift = irb.CreateSelect(irb.CreateICmpUGT(shift, max), max, shift);
+        return irb.CreateAShr(src, shift);
+    }
+
+    // For logical shifts, if shift >= elem_size, result is zero.
+    llvm::Value* res = irb.CreateBinOp(op, src, shift);
+    llvm::Value* zero = llvm::Constant::getNullValue(vec_ty);
+    return irb.CreateSelect(irb.CreateICmpULT(shift, size), res, zero);
+}
+
+void Lifter::LiftAvxPshiftElement(const Instr& inst,
+                                  llvm::Instruction::BinaryOps op,
+                                  Facet op_type) {
+    llvm::Value* src = OpLoad(inst.op(1), op_type);
+    llvm::Value* shift;
+    if (!inst.op(2).is_imm())
+        shift = OpLoad(inst.op(2), Facet::I64);
+    else
+        shift = irb.getInt64(inst.op(2).imm());
+
+    // Clamp the count before truncating it to the element size.
+    llvm::Type* elem_ty = src->getType()->getScalarType();
+    llvm::Value* max = irb.getInt64(elem_ty->getIntegerBitWidth());
+    shift = irb.CreateSelect(irb.CreateICmpUGT(shift, max), max, shift);
+    shift = irb.CreateTrunc(shift, elem_ty);
+    unsigned elem_cnt = VectorElementCount(src->getType());
+    shift = irb.CreateVectorSplat(elem_cnt, shift);
+    OpStoreVex(inst.op(0), AvxShift(op, src, shift));
+}
+
+void Lifter::LiftAvxPshiftVar(const Instr& inst,
+                              llvm::Instruction::BinaryOps op, Facet op_type) {
+    llvm::Value* src = OpLoad(inst.op(1), op_type);
+    llvm::Value* shift = OpLoad(inst.op(2), op_type);
+    OpStoreVex(inst.op(0), AvxShift(op, src, shift));
+}
+
+void Lifter::LiftAvxUnpck(const Instr& inst, Facet op_type, bool high) {
+    // Unpacking operates on each 128-bit lane separately.
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    unsigned cnt = VectorElementCount(op1->getType());
+    unsigned lane_cnt = 128 / op1->getType()->getScalarSizeInBits();
+
+    llvm::SmallVector<int, 32> mask;
+    for (unsigned lane = 0; lane < cnt; lane += lane_cnt) {
+        for (unsigned i = 0; i < lane_cnt / 2; i++) {
+            unsigned idx = lane + i + (high ? lane_cnt / 2 : 0);
+            mask.push_back(idx);
+            mask.push_back(idx + cnt);
+        }
+    }
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(op1, op2, mask));
+}
+
+void Lifter::LiftAvxPshufd(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::VI32);
+    unsigned imm = inst.op(2).imm();
+    llvm::SmallVector<int, 8> mask;
+    for (unsigned i = 0; i < VectorElementCount(src->getType()); i++)
+        mask.push_back((i & ~3u) + ((imm >> 2*(i & 3)) & 3));
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(src, src, mask));
+}
+
+void Lifter::LiftAvxShufps(const Instr& inst) {
+    llvm::Value* op1 = OpLoad(inst.op(1), Facet::VF32);
+    llvm::Value* op2 = OpLoad(inst.op(2), Facet::VF32);
+    unsigned imm = inst.op(3).imm();
+    unsigned cnt = VectorElementCount(op1->getType());
+    llvm::SmallVector<int, 8> mask;
+    for (unsigned i = 0; i < cnt; i++) {
+        unsigned src_off = (i & 3) < 2 ? 0 : cnt;
+        mask.push_back(src_off + (i & ~3u) + ((imm >> 2*(i & 3)) & 3));
+    }
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(op1, op2, mask));
+}
+
+void Lifter::LiftAvxShufpd(const Instr& inst) {
+    llvm::Value* op1 = OpLoad(inst.op(1), Facet::VF64);
+    llvm::Value* op2 = OpLoad(inst.op(2), Facet::VF64);
+    unsigned imm = inst.op(3).imm();
+    unsigned cnt = VectorElementCount(op1->getType());
+    llvm::SmallVector<int, 4> mask;
+    for (unsigned i = 0; i < cnt; i++) {
+        unsigned src_off = i & 1 ? cnt : 0;
+        mask.push_back(src_off + (i & ~1u) + ((imm >> i) & 1));
+    }
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(op1, op2, mask));
+}
+
+void Lifter::LiftAvxPshufb(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::VI8);
+    llvm::Value* sel = OpLoad(inst.op(2), Facet::VI8);
+    llvm::Value* zero = irb.getInt8(0);
+    llvm::Value* res = llvm::Constant::getNullValue(src->getType());
+    // Each byte selects from the 128-bit lane it is in, or is zero if the sign
+    // bit of the selector is set.
+    for (unsigned i = 0; i < VectorElementCount(src->getType()); i++) {
+        llvm::Value* idx = irb.CreateExtractElement(sel, uint64_t{i});
+        llvm::Value* pos = irb.CreateAnd(idx, irb.getInt8(0x0f));
+        pos = irb.CreateOr(pos, irb.getInt8(i & ~15u));
+        llvm::Value* elem = irb.CreateExtractElement(src, pos);
+        elem = irb.CreateSelect(irb.CreateICmpSLT(idx, zero), zero, elem);
+        res = irb.CreateInsertElement(res, elem, uint64_t{i});
+    }
+    OpStoreVex(inst.op(0), res);
+}
+
+void Lifter::LiftAvxPmovx(const Instr& inst, llvm::Instruction::CastOps ext,
+                          Facet from, Facet to) {
+    unsigned cnt = inst.op(0).bits() / to.Size();
+    llvm::Value* src = OpLoad(inst.op(1), Facet::Vnt(cnt, from));
+    llvm::Type* dst_ty = Facet::Vnt(cnt, to).Type(irb.getContext());
+    OpStoreVex(inst.op(0), irb.CreateCast(ext, src, dst_ty));
+}
+
+void Lifter::LiftAvxPtest(const Instr& inst) {
+    llvm::Value* op1 = OpLoad(inst.op(0), Facet::VI64);
+    llvm::Value* op2 = OpLoad(inst.op(1), Facet::VI64);
+    llvm::Type* int_ty = irb.getIntNTy(inst.op(0).bits());
+    llvm::Value* and_val = irb.CreateBitCast(irb.CreateAnd(op1, op2), int_ty);
+    llvm::Value* andn_val = irb.CreateAnd(irb.CreateNot(op1), op2);
+    andn_val = irb.CreateBitCast(andn_val, int_ty);
+    SetReg(ArchReg::ZF, irb.CreateIsNull(and_val));
+    SetReg(ArchReg::CF, irb.CreateIsNull(andn_val));
+    SetReg(ArchReg::PF, irb.getInt8(1)); // constant 1 for low 8 bits -> PF=0
+    SetReg(ArchReg::AF, irb.getFalse());
+    SetReg(ArchReg::OF, irb.getFalse());
+    SetReg(ArchReg::SF, irb.getFalse());
+}
+
+void Lifter::LiftAvxBroadcast(const Instr& inst, Facet type) {
+    llvm::Value* src = OpLoad(inst.op(1), type);
+    unsigned cnt = inst.op(0).bits() / type.Size();
+    if (!src->getType()->isVectorTy()) {
+        OpStoreVex(inst.op(0), irb.CreateVectorSplat(cnt, src));
+        return;
+    }
+
+    unsigned src_cnt = VectorElementCount(src->getType());
+    llvm::SmallVector<int, 8> mask;
+    for (unsigned i = 0; i < cnt * src_cnt; i++)
+        mask.push_back(i % src_cnt);
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(src, src, mask));
+}
+
+void Lifter::LiftAvxInsert128(const Instr& inst) {
+    llvm::Value* src1 = OpLoad(inst.op(1), Facet::V4I64);
+    llvm::Value* src2 = OpLoad(inst.op(2), Facet::V2I64);
+    llvm::Value* zero = llvm::Constant::getNullValue(src2->getType());
+    src2 = CreateShuffleVector(src2, zero, {0, 1, 2, 3});
+    llvm::Value* res;
+    if (inst.op(3).imm() & 1)
+        res = CreateShuffleVector(src1, src2, {0, 1, 4, 5});
+    else
+        res = CreateShuffleVector(src1, src2, {4, 5, 2, 3});
+    OpStoreVex(inst.op(0), res);
+}
+
+void Lifter::LiftAvxExtract128(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::V4I64);
+    llvm::Value* res;
+    if (inst.op(2).imm() & 1)
+        res = CreateShuffleVector(src, src, {2, 3});
+    else
+        res = CreateShuffleVector(src, src, {0, 1});
+    OpStoreVex(inst.op(0), res);
+}
+
+void Lifter::LiftAvxPerm2128(const Instr& inst) {
+    llvm::Value* src1 = OpLoad(inst.op(1), Facet::V4I64);
+    llvm::Value* src2 = OpLoad(inst.op(2), Facet::V4I64);
+    unsigned imm = inst.op(3).imm();
+
+    // Select each half from the four halves of both sources, then clear the
+    // halves that have the zero bit set.
+    int mask[4], zero_mask[4];
+    for (unsigned i = 0; i < 4; i++) {
+        unsigned ctl = imm >> (i & 2 ? 4 : 0);
+        mask[i] = (ctl & 3) * 2 + (i & 1);
+        zero_mask[i] = ctl & 8 ? 4 + i : i;
+    }
+    llvm::Value* res = irb.CreateShuffleVector(src1, src2, mask);
+    if (imm & 0x88) {
+        llvm::Value* zero = llvm::Constant::getNullValue(res->getType());
+        res = irb.CreateShuffleVector(res, zero, zero_mask);
+    }
+    OpStoreVex(inst.op(0), res);
+}
+
+void Lifter::LiftAvxPermq(const Instr& inst, Facet op_type) {
+    llvm::Value* src = OpLoad(inst.op(1), op_type);
+    unsigned imm = inst.op(2).imm();
+    int mask[4];
+    for (unsigned i = 0; i < 4; i++)
+        mask[i] = (imm >> 2*i) & 3;
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(src, src, mask));
+}
+
+void Lifter::LiftAvxBlend(const Instr& inst, Facet op_type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    unsigned imm = inst.op(3).imm();
+    unsigned cnt = VectorElementCount(op1->getType());
+    // VPBLENDW uses the same 8 bits for both 128-bit lanes.
+    llvm::SmallVector<int, 16> mask;
+    for (unsigned i = 0; i < cnt; i++)
+        mask.push_back((imm >> (i & 7)) & 1 ? cnt + i : i);
+    OpStoreVex(inst.op(0), irb.CreateShuffleVector(op1, op2, mask));
+}
+
+void Lifter::LiftAvxBlendv(const Instr& inst, Facet op_type) {
+    llvm::Value* op1 = OpLoad(inst.op(1), op_type);
+    llvm::Value* op2 = OpLoad(inst.op(2), op_type);
+    llvm::Value* sel = OpLoad(inst.op(3), op_type);
+    llvm::Value* zero = llvm::Constant::getNullValue(sel->getType());
+    llvm::Value* cmp = irb.CreateICmpSLT(sel, zero);
+    OpStoreVex(inst.op(0), irb.CreateSelect(cmp, op2, op1));
+}
+
+} // namespace::x86_64
+
+/**
+ * @}
+ **/
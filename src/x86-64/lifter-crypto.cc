@@ -0,0 +1,323 @@
+/**
+ * This file is part of Rellume.
+ *
+ * (c) 2024, Alexis Engelke <alexis.engelke@googlemail.com>
+ *
+ * Rellume is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License (LGPL)
+ * as published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Rellume is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Rellume.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include "x86-64/lifter-private.h"
+
+#include "facet.h"
+#include "instr.h"
+
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/IntrinsicsX86.h>
+#include <llvm/IR/Value.h>
+
+#include <algorithm>
+
+/**
+ * \defgroup LLInstructionCrypto CRC32, AES and PCLMULQDQ Instructions
+ * \ingroup LLInstruction
+ *
+ * Without LLConfig::use_native_crypto, these are lifted to generic IR, so that
+ * the lifted code does not depend on the host supporting these extensions.
+ *
+ * @{
+ **/
+
+namespace rellume::x86_64 {
+
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+static const uint8_t aes_inv_sbox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+
+void Lifter::LiftCrc32(const Instr& inst) {
+    llvm::Value* crc = OpLoad(inst.op(0), Facet::I32);
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    unsigned sz = inst.op(1).bits();
+
+    if (cfg.use_native_crypto) {
+        llvm::Intrinsic::ID id;
+        switch (sz) {
+        case 8: id = llvm::Intrinsic::x86_sse42_crc32_32_8; break;
+        case 16: id = llvm::Intrinsic::x86_sse42_crc32_32_16; break;
+        case 32: id = llvm::Intrinsic::x86_sse42_crc32_32_32; break;
+        default:
+            id = llvm::Intrinsic::x86_sse42_crc32_64_64;
+            crc = irb.CreateZExt(crc, irb.getInt64Ty());
+            break;
+        }
+        llvm::Module* module = irb.GetInsertBlock()->getModule();
+        auto intrinsic = llvm::Intrinsic::getDeclaration(module, id);
+        llvm::Value* res = irb.CreateCall(intrinsic, {crc, src});
+        StoreGp(MapReg(inst.op(0).reg()), irb.CreateZExt(res, irb.getInt64Ty()));
+        return;
+    }
+
+    // Bitwise CRC-32C (Castagnoli) with the reflected polynomial, consuming
+    // at most 32 bits of the source at a time.
+    llvm::Value* poly = irb.getInt32(0x82f63b78);
+    for (unsigned off = 0; off < sz; off += 32) {
+        llvm::Value* data = irb.CreateLShr(src, off);
+        crc = irb.CreateXor(crc, irb.CreateZExtOrTrunc(data, irb.getInt32Ty()));
+        for (unsigned i = 0; i < std::min(sz - off, 32u); i++) {
+            llvm::Value* lsb = irb.CreateAnd(crc, 1);
+            llvm::Value* mask = irb.CreateNeg(lsb);
+            crc = irb.CreateXor(irb.CreateLShr(crc, 1), irb.CreateAnd(mask, poly));
+        }
+    }
+    // The result is always zero-extended to 64 bits.
+    StoreGp(MapReg(inst.op(0).reg()), irb.CreateZExt(crc, irb.getInt64Ty()));
+}
+
+void Lifter::LiftPclmulqdq(const Instr& inst, bool vex) {
+    unsigned base = vex ? 1 : 0;
+    llvm::Value* src1 = OpLoad(inst.op(base), Facet::V2I64);
+    llvm::Value* src2 = OpLoad(inst.op(base + 1), Facet::V2I64, vex ? ALIGN_NONE : ALIGN_MAX);
+    unsigned imm = inst.op(base + 2).imm();
+
+    llvm::Value* res;
+    if (cfg.use_native_crypto) {
+        llvm::Module* module = irb.GetInsertBlock()->getModule();
+        auto id = llvm::Intrinsic::x86_pclmulqdq;
+        auto intrinsic = llvm::Intrinsic::getDeclaration(module, id);
+        res = irb.CreateCall(intrinsic, {src1, src2, irb.getInt8(imm)});
+    } else {
+        llvm::Type* i128 = irb.getInt128Ty();
+        llvm::Value* a = irb.CreateExtractElement(src1, uint64_t{imm & 1});
+        llvm::Value* b = irb.CreateExtractElement(src2, uint64_t{(imm >> 4) & 1});
+        a = irb.CreateZExt(a, i128);
+
+        // XOR shifted copies of a for every set bit of b.
+        llvm::Value* zero = llvm::Constant::getNullValue(i128);
+        llvm::BasicBlock* header_block = irb.GetInsertBlock();
+        llvm::BasicBlock* loop_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+        llvm::BasicBlock* cont_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+        irb.CreateCondBr(irb.CreateIsNull(b), cont_block, loop_block);
+
+        SetInsertBlock(loop_block);
+        llvm::PHINode* rem = irb.CreatePHI(b->getType(), 2);
+        llvm::PHINode* acc = irb.CreatePHI(i128, 2);
+        llvm::Value* shift = irb.CreateBinaryIntrinsic(llvm::Intrinsic::cttz, rem,
+                                                       /*zero_undef=*/irb.getTrue());
+        llvm::Value* next_acc = irb.CreateXor(acc, irb.CreateShl(a, irb.CreateZExt(shift, i128)));
+        llvm::Value* next_rem = irb.CreateAnd(rem, irb.CreateSub(rem, irb.getInt64(1)));
+        irb.CreateCondBr(irb.CreateIsNull(next_rem), cont_block, loop_block);
+        rem->addIncoming(b, header_block);
+        rem->addIncoming(next_rem, loop_block);
+        acc->addIncoming(zero, header_block);
+        acc->addIncoming(next_acc, loop_block);
+
+        SetInsertBlock(cont_block);
+        llvm::PHINode* phi = irb.CreatePHI(i128, 2);
+        phi->addIncoming(zero, header_block);
+        phi->addIncoming(next_acc, loop_block);
+        res = irb.CreateBitCast(phi, src1->getType());
+    }
+
+    if (vex)
+        OpStoreVex(inst.op(0), res);
+    else
+        OpStoreVec(inst.op(0), res);
+}
+
+llvm::Value* Lifter::AesSubBytes(llvm::Value* state, bool inverse) {
+    llvm::Module* module = irb.GetInsertBlock()->getModule();
+    const char* name = inverse ? "rellume_aes_inv_sbox" : "rellume_aes_sbox";
+    llvm::GlobalVariable* table = module->getNamedGlobal(name);
+    if (!table) {
+        auto data = llvm::ArrayRef<uint8_t>(inverse ? aes_inv_sbox : aes_sbox);
+        auto init = llvm::ConstantDataArray::get(irb.getContext(), data);
+        table = new llvm::GlobalVariable(*module, init->getType(), /*const=*/true,
+                                         llvm::GlobalValue::PrivateLinkage,
+                                         init, name);
+    }
+
+    llvm::Type* table_ty = table->getValueType();
+    llvm::Value* res = llvm::Constant::getNullValue(state->getType());
+    for (unsigned i = 0; i < 16; i++) {
+        llvm::Value* idx = irb.CreateExtractElement(state, uint64_t{i});
+        idx = irb.CreateZExt(idx, irb.getInt64Ty());
+        llvm::Value* ptr = irb.CreateGEP(table_ty, table, {irb.getInt64(0), idx});
+        llvm::Value* elem = irb.CreateLoad(irb.getInt8Ty(), ptr);
+        res = irb.CreateInsertElement(res, elem, uint64_t{i});
+    }
+    return res;
+}
+
+llvm::Value* Lifter::AesShiftRows(llvm::Value* state, bool inverse) {
+    // Byte i of the state is row i%4 of column i/4.
+    int mask[16];
+    for (unsigned i = 0; i < 16; i++) {
+        unsigned row = i & 3, col = i >> 2;
+        unsigned src_col = inverse ? (col - row) & 3 : (col + row) & 3;
+        mask[i] = row + 4 * src_col;
+    }
+    return irb.CreateShuffleVector(state, state, mask);
+}
+
+llvm::Value* Lifter::AesMixColumns(llvm::Value* state, bool inverse) {
+    llvm::Type* ty = state->getType();
+    auto xtime = [&] (llvm::Value* v) {
+        llvm::Value* hi = irb.CreateAShr(v, llvm::ConstantInt::get(ty, 7));
+        llvm::Value* red = irb.CreateAnd(hi, llvm::ConstantInt::get(ty, 0x1b));
+        return irb.CreateXor(irb.CreateShl(v, llvm::ConstantInt::get(ty, 1)), red);
+    };
+    // Rotate the bytes within each column by n rows.
+    auto rot = [&] (llvm::Value* v, unsigned n) {
+        int mask[16];
+        for (unsigned i = 0; i < 16; i++)
+            mask[i] = (i & ~3u) + ((i + n) & 3);
+        return irb.CreateShuffleVector(v, v, mask);
+    };
+
+    // InvMixColumns is MixColumns after adding 4*(a[r] ^ a[r+2]) to a[r].
+    if (inverse)
+        state = irb.CreateXor(state, xtime(xtime(irb.CreateXor(state, rot(state, 2)))));
+
+    llvm::Value* rot1 = rot(state, 1);
+    llvm::Value* res = xtime(irb.CreateXor(state, rot1));
+    res = irb.CreateXor(res, rot1);
+    res = irb.CreateXor(res, rot(state, 2));
+    return irb.CreateXor(res, rot(state, 3));
+}
+
+void Lifter::LiftAes(const Instr& inst, bool decrypt, bool last, bool vex) {
+    unsigned base = vex ? 1 : 0;
+    llvm::Value* state = OpLoad(inst.op(base), Facet::V16I8);
+    llvm::Value* key = OpLoad(inst.op(base + 1), Facet::V16I8, vex ? ALIGN_NONE : ALIGN_MAX);
+
+    llvm::Value* res;
+    if (cfg.use_native_crypto) {
+        llvm::Intrinsic::ID id;
+        if (decrypt)
+            id = last ? llvm::Intrinsic::x86_aesni_aesdeclast : llvm::Intrinsic::x86_aesni_aesdec;
+        else
+            id = last ? llvm::Intrinsic::x86_aesni_aesenclast : llvm::Intrinsic::x86_aesni_aesenc;
+        llvm::Module* module = irb.GetInsertBlock()->getModule();
+        auto intrinsic = llvm::Intrinsic::getDeclaration(module, id);
+        llvm::Type* vec_ty = Facet{Facet::V2I64}.Type(irb.getContext());
+        res = irb.CreateCall(intrinsic, {irb.CreateBitCast(state, vec_ty),
+                                         irb.CreateBitCast(key, vec_ty)});
+    } else {
+        res = AesSubBytes(AesShiftRows(state, decrypt), decrypt);
+        if (!last)
+            res = AesMixColumns(res, decrypt);
+        res = irb.CreateXor(res, key);
+    }
+
+    if (vex)
+        OpStoreVex(inst.op(0), res);
+    else
+        OpStoreVec(inst.op(0), res);
+}
+
+void Lifter::LiftAesimc(const Instr& inst, bool vex) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::V16I8, vex ? ALIGN_NONE : ALIGN_MAX);
+
+    llvm::Value* res;
+    if (cfg.use_native_crypto) {
+        llvm::Module* module = irb.GetInsertBlock()->getModule();
+        auto id = llvm::Intrinsic::x86_aesni_aesimc;
+        auto intrinsic = llvm::Intrinsic::getDeclaration(module, id);
+        llvm::Type* vec_ty = Facet{Facet::V2I64}.Type(irb.getContext());
+        res = irb.CreateCall(intrinsic, {irb.CreateBitCast(src, vec_ty)});
+    } else {
+        res = AesMixColumns(src, /*inverse=*/true);
+    }
+
+    if (vex)
+        OpStoreVex(inst.op(0), res);
+    else
+        OpStoreVec(inst.op(0), res);
+}
+
+void Lifter::LiftAeskeygenassist(const Instr& inst, bool vex) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::V16I8, vex ? ALIGN_NONE : ALIGN_MAX);
+    unsigned imm = inst.op(2).imm();
+
+    llvm::Value* res;
+    if (cfg.use_native_crypto) {
+        llvm::Module* module = irb.GetInsertBlock()->getModule();
+        auto id = llvm::Intrinsic::x86_aesni_aeskeygenassist;
+        auto intrinsic = llvm::Intrinsic::getDeclaration(module, id);
+        llvm::Type* vec_ty = Facet{Facet::V2I64}.Type(irb.getContext());
+        res = irb.CreateCall(intrinsic, {irb.CreateBitCast(src, vec_ty),
+                                         irb.getInt8(imm)});
+    } else {
+        // Result is SubWord(X1), RotWord(SubWord(X1)) ^ RCON, SubWord(X3),
+        // RotWord(SubWord(X3)) ^ RCON, where Xn is the n-th dword of src.
+        llvm::Value* sub = AesSubBytes(src, /*inverse=*/false);
+        llvm::Value* words = CreateShuffleVector(sub, sub, {4, 5, 6, 7,
+                                                            5, 6, 7, 4,
+                                                            12, 13, 14, 15,
+                                                            13, 14, 15, 12});
+        llvm::Type* v4i32 = Facet{Facet::V4I32}.Type(irb.getContext());
+        llvm::Constant* rcon = llvm::ConstantVector::get({
+            irb.getInt32(0), irb.getInt32(imm), irb.getInt32(0), irb.getInt32(imm),
+        });
+        res = irb.CreateXor(irb.CreateBitCast(words, v4i32), rcon);
+    }
+
+    if (vex)
+        OpStoreVex(inst.op(0), res);
+    else
+        OpStoreVec(inst.op(0), res);
+}
+
+} // namespace::x86_64
+
+/**
+ * @}
+ **/
@@ -23,6 +23,7 @@
 
 #include "x86-64/lifter-private.h"
 
+#include "config.h"
 #include "instr.h"
 #include "regfile.h"
 #include <llvm/IR/Intrinsics.h>
@@ -42,20 +43,28 @@
 namespace rellume::x86_64 {
 
 void Lifter::FlagCalcSAPLogic(llvm::Value* res) {
-    regfile->Set(ArchReg::SF, RegFile::Transform::IsNeg, res);
-    regfile->Set(ArchReg::PF, RegFile::Transform::TruncI8, res);
-    SetFlagUndef({ArchReg::AF});
+    if (!FlagDead(ArchReg::SF))
+        regfile->Set(ArchReg::SF, RegFile::Transform::IsNeg, res);
+    if (!FlagDead(ArchReg::PF))
+        regfile->Set(ArchReg::PF, RegFile::Transform::TruncI8, res);
+    if (!FlagDead(ArchReg::AF))
+        SetFlagUndef({ArchReg::AF});
 }
 
 void Lifter::FlagCalcAdd(llvm::Value* res, llvm::Value* lhs,
                          llvm::Value* rhs, bool skip_carry) {
-    regfile->Set(ArchReg::ZF, RegFile::Transform::IsZero, res);
-    regfile->Set(ArchReg::SF, RegFile::Transform::IsNeg, res);
-    regfile->Set(ArchReg::PF, RegFile::Transform::TruncI8, res);
-    regfile->Set(ArchReg::AF, RegFile::Transform::X86AuxFlag, res, lhs, rhs);
-    if (!skip_carry)
+    FlagCalcZ(res);
+    if (!FlagDead(ArchReg::SF))
+        regfile->Set(ArchReg::SF, RegFile::Transform::IsNeg, res);
+    if (!FlagDead(ArchReg::PF))
+        regfile->Set(ArchReg::PF, RegFile::Transform::TruncI8, res);
+    if (!FlagDead(ArchReg::AF))
+        regfile->Set(ArchReg::AF, RegFile::Transform::X86AuxFlag, res, lhs, rhs);
+    if (!skip_carry && !FlagDead(ArchReg::CF))
         regfile->Set(ArchReg::CF, RegFile::Transform::IsULT, res, lhs);
 
+    if (FlagDead(ArchReg::OF))
+        return;
     if (cfg.enableOverflowIntrinsics) {
         llvm::Intrinsic::ID id = llvm::Intrinsic::sadd_with_overflow;
         llvm::Value* packed = irb.CreateBinaryIntrinsic(id, lhs, rhs);
@@ -67,24 +76,53 @@ void Lifter::FlagCalcAdd(llvm::Value* res, llvm::Value* lhs,
 
 void Lifter::FlagCalcSub(llvm::Value* res, llvm::Value* lhs,
                          llvm::Value* rhs, bool skip_carry, bool alt_zf) {
-    auto zero = llvm::Constant::getNullValue(res->getType());
-    llvm::Value* sf = irb.CreateICmpSLT(res, zero);  // also used for OF
-
-    if (alt_zf)
+    if (!alt_zf)
+        FlagCalcZ(res);
+    else if (!FlagDead(ArchReg::ZF))
         SetReg(ArchReg::ZF, irb.CreateICmpEQ(lhs, rhs));
-    else
-        regfile->Set(ArchReg::ZF, RegFile::Transform::IsZero, res);
-    SetReg(ArchReg::SF, sf);
-    regfile->Set(ArchReg::PF, RegFile::Transform::TruncI8, res);
-    regfile->Set(ArchReg::AF, RegFile::Transform::X86AuxFlag, res, lhs, rhs);
-    if (!skip_carry)
+    if (!FlagDead(ArchReg::PF))
+        regfile->Set(ArchReg::PF, RegFile::Transform::TruncI8, res);
+    if (!FlagDead(ArchReg::AF))
+        regfile->Set(ArchReg::AF, RegFile::Transform::X86AuxFlag, res, lhs, rhs);
+    if (!skip_carry && !FlagDead(ArchReg::CF))
         regfile->Set(ArchReg::CF, RegFile::Transform::IsULT, lhs, rhs);
 
-    // Set overflow flag using arithmetic comparisons
-    SetReg(ArchReg::OF, irb.CreateICmpNE(sf, irb.CreateICmpSLT(lhs, rhs)));
+    if (!FlagDead(ArchReg::SF) || !FlagDead(ArchReg::OF)) {
+        auto zero = llvm::Constant::getNullValue(res->getType());
+        llvm::Value* sf = irb.CreateICmpSLT(res, zero);  // also used for OF
+        if (!FlagDead(ArchReg::SF))
+            SetReg(ArchReg::SF, sf);
+        // Set overflow flag using arithmetic comparisons
+        if (!FlagDead(ArchReg::OF))
+            SetReg(ArchReg::OF, irb.CreateICmpNE(sf, irb.CreateICmpSLT(lhs, rhs)));
+    }
+
+    // Without carry, the flags don't fully describe the comparison.
+    if (!skip_carry)
+        regfile->SetFlagCmp(lhs, rhs);
 }
 
 llvm::Value* Lifter::FlagCond(Condition cond) {
+    // If the flags come from a comparison, use a single integer comparison.
+    if (auto [lhs, rhs] = regfile->GetFlagCmp(); lhs) {
+        auto pred = llvm::CmpInst::BAD_ICMP_PREDICATE;
+        switch (cond) {
+        case Condition::C:  pred = llvm::CmpInst::ICMP_ULT; break;
+        case Condition::NC: pred = llvm::CmpInst::ICMP_UGE; break;
+        case Condition::Z:  pred = llvm::CmpInst::ICMP_EQ; break;
+        case Condition::NZ: pred = llvm::CmpInst::ICMP_NE; break;
+        case Condition::BE: pred = llvm::CmpInst::ICMP_ULE; break;
+        case Condition::A:  pred = llvm::CmpInst::ICMP_UGT; break;
+        case Condition::L:  pred = llvm::CmpInst::ICMP_SLT; break;
+        case Condition::GE: pred = llvm::CmpInst::ICMP_SGE; break;
+        case Condition::LE: pred = llvm::CmpInst::ICMP_SLE; break;
+        case Condition::G:  pred = llvm::CmpInst::ICMP_SGT; break;
+        default: break; // O, S, P need the flag values
+        }
+        if (pred != llvm::CmpInst::BAD_ICMP_PREDICATE)
+            return irb.CreateICmp(pred, lhs, rhs);
+    }
+
     llvm::Value* result = nullptr;
     switch (static_cast<Condition>(static_cast<int>(cond) & ~1)) {
     case Condition::O:  result = GetFlag(ArchReg::OF); break;
@@ -131,6 +169,115 @@ void Lifter::FlagFromReg(llvm::Value* val) {
     }
 }
 
+static unsigned FlagMask(std::initializer_list<ArchReg> flags) {
+    unsigned mask = 0;
+    for (ArchReg flag : flags)
+        mask |= 1u << flag.Index();
+    return mask;
+}
+
+static unsigned CondFlags(Condition cond) {
+    switch (static_cast<Condition>(static_cast<int>(cond) & ~1)) {
+    case Condition::O:  return FlagMask({ArchReg::OF});
+    case Condition::C:  return FlagMask({ArchReg::CF});
+    case Condition::Z:  return FlagMask({ArchReg::ZF});
+    case Condition::BE: return FlagMask({ArchReg::CF, ArchReg::ZF});
+    case Condition::S:  return FlagMask({ArchReg::SF});
+    case Condition::P:  return FlagMask({ArchReg::PF});
+    case Condition::L:  return FlagMask({ArchReg::SF, ArchReg::OF});
+    case Condition::LE: return FlagMask({ArchReg::ZF, ArchReg::SF, ArchReg::OF});
+    default: assert(0); return 0;
+    }
+}
+
+std::pair<unsigned, unsigned> InstrFlagEffects(const Instr& inst,
+                                               const LLConfig& cfg) noexcept {
+    const unsigned all = FlagMask({ArchReg::ZF, ArchReg::SF, ArchReg::PF,
+                                   ArchReg::CF, ArchReg::OF, ArchReg::AF,
+                                   ArchReg::DF});
+    const unsigned status = FlagMask({ArchReg::ZF, ArchReg::SF, ArchReg::PF,
+                                      ArchReg::CF, ArchReg::OF, ArchReg::AF});
+    const unsigned cf = FlagMask({ArchReg::CF});
+
+    // Overridden instructions can do anything with the flags.
+    if (cfg.instr_overrides.count(inst.type()))
+        return {all, 0};
+
+    switch (inst.type()) {
+    default: return {all, 0};
+    case FDI_NOP:
+    case FDI_ENDBR64:
+    case FDI_PUSH:
+    case FDI_POP:
+    case FDI_LEAVE:
+    case FDI_MOV:
+    case FDI_MOVABS:
+    case FDI_MOVZX:
+    case FDI_MOVSX:
+    case FDI_MOVNTI:
+    case FDI_MOVBE:
+    case FDI_XCHG:
+    case FDI_LEA:
+    case FDI_NOT:
+    case FDI_BSWAP:
+    case FDI_C_EX:
+    case FDI_C_SEP:
+    case FDI_JMP:
+    case FDI_SSE_MOVD:
+    case FDI_SSE_MOVQ:
+    case FDI_SSE_MOVSS:
+    case FDI_SSE_MOVSD:
+    case FDI_SSE_MOVUPS:
+    case FDI_SSE_MOVUPD:
+    case FDI_SSE_MOVAPS:
+    case FDI_SSE_MOVAPD:
+    case FDI_SSE_MOVDQU:
+    case FDI_SSE_MOVDQA:
+    case FDI_SSE_PXOR:
+    case FDI_SSE_XORPS:
+    case FDI_SSE_XORPD:
+        return {0, 0};
+    case FDI_ADD:
+    case FDI_SUB:
+    case FDI_CMP:
+    case FDI_NEG:
+    case FDI_XADD:
+    case FDI_CMPXCHG:
+    case FDI_AND:
+    case FDI_OR:
+    case FDI_XOR:
+    case FDI_TEST:
+        return {0, status};
+    case FDI_ADC:
+    case FDI_SBB:
+        return {cf, status};
+    case FDI_INC:
+    case FDI_DEC:
+        return {0, status & ~cf};
+    case FDI_CLC:
+    case FDI_STC:
+        return {0, cf};
+    case FDI_CMC:
+        return {cf, cf};
+    case FDI_JO: case FDI_SETO: case FDI_CMOVO: return {CondFlags(Condition::O), 0};
+    case FDI_JNO: case FDI_SETNO: case FDI_CMOVNO: return {CondFlags(Condition::NO), 0};
+    case FDI_JC: case FDI_SETC: case FDI_CMOVC: return {CondFlags(Condition::C), 0};
+    case FDI_JNC: case FDI_SETNC: case FDI_CMOVNC: return {CondFlags(Condition::NC), 0};
+    case FDI_JZ: case FDI_SETZ: case FDI_CMOVZ: return {CondFlags(Condition::Z), 0};
+    case FDI_JNZ: case FDI_SETNZ: case FDI_CMOVNZ: return {CondFlags(Condition::NZ), 0};
+    case FDI_JBE: case FDI_SETBE: case FDI_CMOVBE: return {CondFlags(Condition::BE), 0};
+    case FDI_JA: case FDI_SETA: case FDI_CMOVA: return {CondFlags(Condition::A), 0};
+    case FDI_JS: case FDI_SETS: case FDI_CMOVS: return {CondFlags(Condition::S), 0};
+    case FDI_JNS: case FDI_SETNS: case FDI_CMOVNS: return {CondFlags(Condition::NS), 0};
+    case FDI_JP: case FDI_SETP: case FDI_CMOVP: return {CondFlags(Condition::P), 0};
+    case FDI_JNP: case FDI_SETNP: case FDI_CMOVNP: return {CondFlags(Condition::NP), 0};
+    case FDI_JL: case FDI_SETL: case FDI_CMOVL: return {CondFlags(Condition::L), 0};
+    case FDI_JGE: case FDI_SETGE: case FDI_CMOVGE: return {CondFlags(Condition::GE), 0};
+    case FDI_JLE: case FDI_SETLE: case FDI_CMOVLE: return {CondFlags(Condition::LE), 0};
+    case FDI_JG: case FDI_SETG: case FDI_CMOVG: return {CondFlags(Condition::G), 0};
+    }
+}
+
 } // namespace::x86_64
 
 /**
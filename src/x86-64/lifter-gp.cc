@@ -28,6 +28,7 @@
 #include "regfile.h"
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/IntrinsicsX86.h>
 #include <llvm/IR/Value.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 
@@ -162,6 +163,8 @@ void Lifter::LiftAndOrXor(const Instr& inst, llvm::Instruction::BinaryOps op,
     FlagCalcSAPLogic(res);
     SetReg(ArchReg::CF, irb.getFalse());
     SetReg(ArchReg::OF, irb.getFalse());
+    // The flags are the same as for comparing the result with zero.
+    regfile->SetFlagCmp(res, llvm::Constant::getNullValue(res->getType()));
 }
 
 void Lifter::LiftNot(const Instr& inst) {
@@ -533,6 +536,215 @@ void Lifter::LiftPopcnt(const Instr& inst) {
     SetReg(ArchReg::CF, irb.getFalse());
 }
 
+void Lifter::LiftLzTzcnt(const Instr& inst, bool trailing) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    auto id = trailing ? llvm::Intrinsic::cttz : llvm::Intrinsic::ctlz;
+    // Unlike BSF/BSR, the result is the operand size if src is zero.
+    llvm::Value* res = irb.CreateBinaryIntrinsic(id, src,
+                                                 /*zero_undef=*/irb.getFalse());
+    OpStoreGp(inst.op(0), res);
+
+    SetReg(ArchReg::CF, irb.CreateIsNull(src));
+    SetReg(ArchReg::ZF, irb.CreateIsNull(res));
+    SetFlagUndef({ArchReg::OF, ArchReg::SF, ArchReg::AF, ArchReg::PF});
+}
+
+void Lifter::LiftAndn(const Instr& inst) {
+    llvm::Value* src1 = OpLoad(inst.op(1), Facet::I);
+    llvm::Value* src2 = OpLoad(inst.op(2), Facet::I);
+    llvm::Value* res = irb.CreateAnd(irb.CreateNot(src1), src2);
+    OpStoreGp(inst.op(0), res);
+
+    FlagCalcZ(res);
+    SetReg(ArchReg::SF, irb.CreateIsNeg(res));
+    SetReg(ArchReg::CF, irb.getFalse());
+    SetReg(ArchReg::OF, irb.getFalse());
+    SetFlagUndef({ArchReg::AF, ArchReg::PF});
+}
+
+void Lifter::LiftBextr(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    llvm::Value* ctl = OpLoad(inst.op(2), Facet::I);
+    llvm::Type* ty = src->getType();
+    unsigned sz = ty->getIntegerBitWidth();
+
+    llvm::Value* start = irb.CreateAnd(ctl, 0xff);
+    llvm::Value* len = irb.CreateAnd(irb.CreateLShr(ctl, 8), 0xff);
+    // Shifts by the operand size or more are poison in LLVM, so select the
+    // saturated result for these instead.
+    llvm::Value* zero = llvm::Constant::getNullValue(ty);
+    llvm::Value* start_ok = irb.CreateICmpULT(start, llvm::ConstantInt::get(ty, sz));
+    llvm::Value* shifted = irb.CreateSelect(start_ok, irb.CreateLShr(src, start), zero);
+    llvm::Value* len_ok = irb.CreateICmpULT(len, llvm::ConstantInt::get(ty, sz));
+    llvm::Value* mask = irb.CreateSub(irb.CreateShl(llvm::ConstantInt::get(ty, 1), len),
+                                      llvm::ConstantInt::get(ty, 1));
+    mask = irb.CreateSelect(len_ok, mask, llvm::Constant::getAllOnesValue(ty));
+    llvm::Value* res = irb.CreateAnd(shifted, mask);
+    OpStoreGp(inst.op(0), res);
+
+    FlagCalcZ(res);
+    SetReg(ArchReg::CF, irb.getFalse());
+    SetReg(ArchReg::OF, irb.getFalse());
+    SetFlagUndef({ArchReg::AF, ArchReg::SF, ArchReg::PF});
+}
+
+void Lifter::LiftBls(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    llvm::Value* one = llvm::ConstantInt::get(src->getType(), 1);
+    llvm::Value* res;
+    switch (inst.type()) {
+    case FDI_BLSI: // isolate lowest set bit
+        res = irb.CreateAnd(src, irb.CreateNeg(src));
+        SetReg(ArchReg::CF, irb.CreateIsNotNull(src));
+        break;
+    case FDI_BLSMSK: // mask up to lowest set bit
+        res = irb.CreateXor(src, irb.CreateSub(src, one));
+        SetReg(ArchReg::CF, irb.CreateIsNull(src));
+        break;
+    case FDI_BLSR: // reset lowest set bit
+        res = irb.CreateAnd(src, irb.CreateSub(src, one));
+        SetReg(ArchReg::CF, irb.CreateIsNull(src));
+        break;
+    default:
+        assert(false && "invalid BLS* instruction");
+        return;
+    }
+    OpStoreGp(inst.op(0), res);
+
+    if (inst.type() == FDI_BLSMSK)
+        SetReg(ArchReg::ZF, irb.getFalse());
+    else
+        FlagCalcZ(res);
+    SetReg(ArchReg::SF, irb.CreateIsNeg(res));
+    SetReg(ArchReg::OF, irb.getFalse());
+    SetFlagUndef({ArchReg::AF, ArchReg::PF});
+}
+
+void Lifter::LiftBzhi(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    llvm::Value* idx = OpLoad(inst.op(2), Facet::I);
+    llvm::Type* ty = src->getType();
+    unsigned sz = ty->getIntegerBitWidth();
+
+    idx = irb.CreateAnd(idx, 0xff);
+    llvm::Value* idx_ok = irb.CreateICmpULT(idx, llvm::ConstantInt::get(ty, sz));
+    llvm::Value* mask = irb.CreateSub(irb.CreateShl(llvm::ConstantInt::get(ty, 1), idx),
+                                      llvm::ConstantInt::get(ty, 1));
+    llvm::Value* res = irb.CreateSelect(idx_ok, irb.CreateAnd(src, mask), src);
+    OpStoreGp(inst.op(0), res);
+
+    FlagCalcZ(res);
+    SetReg(ArchReg::SF, irb.CreateIsNeg(res));
+    SetReg(ArchReg::CF, irb.CreateNot(idx_ok));
+    SetReg(ArchReg::OF, irb.getFalse());
+    SetFlagUndef({ArchReg::AF, ArchReg::PF});
+}
+
+void Lifter::LiftShiftx(const Instr& inst, llvm::Instruction::BinaryOps op) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    llvm::Value* shift = OpLoad(inst.op(2), Facet::I);
+    unsigned mask = inst.op(0).size() == 8 ? 0x3f : 0x1f;
+    // Flags are not affected.
+    OpStoreGp(inst.op(0), irb.CreateBinOp(op, src, irb.CreateAnd(shift, mask)));
+}
+
+void Lifter::LiftRorx(const Instr& inst) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    unsigned mask = inst.op(0).size() == 8 ? 0x3f : 0x1f;
+    llvm::Value* shift = llvm::ConstantInt::get(src->getType(),
+                                                inst.op(2).imm() & mask);
+    llvm::Module* module = irb.GetInsertBlock()->getModule();
+    auto intrinsic = llvm::Intrinsic::getDeclaration(module, llvm::Intrinsic::fshr,
+                                                     {src->getType()});
+    // Flags are not affected.
+    OpStoreGp(inst.op(0), irb.CreateCall(intrinsic, {src, src, shift}));
+}
+
+void Lifter::LiftMulx(const Instr& inst) {
+    unsigned sz = inst.op(0).bits();
+    llvm::Value* src = OpLoad(inst.op(2), Facet::I);
+    llvm::Value* rdx = GetReg(ArchReg::RDX, Facet::In(sz));
+
+    llvm::Type* double_ty = irb.getIntNTy(sz * 2);
+    llvm::Value* res = irb.CreateMul(irb.CreateZExt(src, double_ty),
+                                     irb.CreateZExt(rdx, double_ty));
+    llvm::Type* value_ty = irb.getIntNTy(sz);
+    // If both destinations are the same register, the high half wins.
+    OpStoreGp(inst.op(1), irb.CreateTrunc(res, value_ty));
+    OpStoreGp(inst.op(0), irb.CreateTrunc(irb.CreateLShr(res, sz), value_ty));
+}
+
+void Lifter::LiftPdepPext(const Instr& inst, bool deposit) {
+    llvm::Value* src = OpLoad(inst.op(1), Facet::I);
+    llvm::Value* mask = OpLoad(inst.op(2), Facet::I);
+    llvm::Type* ty = src->getType();
+    bool is64 = ty->getIntegerBitWidth() == 64;
+
+    if (cfg.use_native_bmi2) {
+        llvm::Intrinsic::ID id;
+        if (deposit)
+            id = is64 ? llvm::Intrinsic::x86_bmi_pdep_64 : llvm::Intrinsic::x86_bmi_pdep_32;
+        else
+            id = is64 ? llvm::Intrinsic::x86_bmi_pext_64 : llvm::Intrinsic::x86_bmi_pext_32;
+        llvm::Module* module = irb.GetInsertBlock()->getModule();
+        auto intrinsic = llvm::Intrinsic::getDeclaration(module, id);
+        OpStoreGp(inst.op(0), irb.CreateCall(intrinsic, {src, mask}));
+        return;
+    }
+
+    // Iterate over the set bits of the mask; bit is the corresponding bit of
+    // the packed value.
+    llvm::Value* zero = llvm::Constant::getNullValue(ty);
+    llvm::Value* one = llvm::ConstantInt::get(ty, 1);
+    llvm::BasicBlock* header_block = irb.GetInsertBlock();
+    llvm::BasicBlock* loop_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    llvm::BasicBlock* cont_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    irb.CreateCondBr(irb.CreateIsNull(mask), cont_block, loop_block);
+
+    SetInsertBlock(loop_block);
+    llvm::PHINode* rem = irb.CreatePHI(ty, 2);
+    llvm::PHINode* bit = irb.CreatePHI(ty, 2);
+    llvm::PHINode* acc = irb.CreatePHI(ty, 2);
+    llvm::Value* low = irb.CreateAnd(rem, irb.CreateNeg(rem));
+    llvm::Value* set;
+    if (deposit)
+        set = irb.CreateSelect(irb.CreateIsNull(irb.CreateAnd(src, bit)), zero, low);
+    else
+        set = irb.CreateSelect(irb.CreateIsNull(irb.CreateAnd(src, low)), zero, bit);
+    llvm::Value* next_acc = irb.CreateOr(acc, set);
+    llvm::Value* next_rem = irb.CreateAnd(rem, irb.CreateSub(rem, one));
+    llvm::Value* next_bit = irb.CreateShl(bit, one);
+    irb.CreateCondBr(irb.CreateIsNull(next_rem), cont_block, loop_block);
+    rem->addIncoming(mask, header_block);
+    rem->addIncoming(next_rem, loop_block);
+    bit->addIncoming(one, header_block);
+    bit->addIncoming(next_bit, loop_block);
+    acc->addIncoming(zero, header_block);
+    acc->addIncoming(next_acc, loop_block);
+
+    SetInsertBlock(cont_block);
+    llvm::PHINode* res = irb.CreatePHI(ty, 2);
+    res->addIncoming(zero, header_block);
+    res->addIncoming(next_acc, loop_block);
+    // Flags are not affected.
+    OpStoreGp(inst.op(0), res);
+}
+
+void Lifter::LiftAdcxAdox(const Instr& inst, ArchReg flag) {
+    llvm::Value* op1 = OpLoad(inst.op(0), Facet::I);
+    llvm::Value* op2 = OpLoad(inst.op(1), Facet::I);
+    unsigned sz = op1->getType()->getIntegerBitWidth();
+
+    // Only the carry chain flag (CF for ADCX, OF for ADOX) is read and
+    // written, so that two chains can be interleaved.
+    llvm::Type* double_ty = irb.getIntNTy(sz * 2);
+    llvm::Value* sum = irb.CreateAdd(irb.CreateZExt(op1, double_ty),
+                                     irb.CreateZExt(op2, double_ty));
+    sum = irb.CreateAdd(sum, irb.CreateZExt(GetFlag(flag), double_ty));
+    OpStoreGp(inst.op(0), irb.CreateTrunc(sum, op1->getType()));
+    SetReg(flag, irb.CreateTrunc(irb.CreateLShr(sum, sz), irb.getInt1Ty()));
+}
+
 void Lifter::LiftBittest(const Instr& inst, llvm::Instruction::BinaryOps op,
                          llvm::AtomicRMWInst::BinOp atomic_op) {
     llvm::Value* index = OpLoad(inst.op(1), Facet::I);
@@ -640,13 +852,15 @@ void Lifter::LiftCall(const Instr& inst) {
                       ArchReg::CF});
 
     // Force default data segment, 3e is notrack.
-    llvm::Value* new_rip;
-    if (inst.op(0).is_pcrel())
-        new_rip = AddrIPRel(inst.op(0).pcrel());
-    else
+    llvm::Value* new_rip = nullptr;
+    if (!inst.op(0).is_pcrel())
         new_rip = OpLoad(inst.op(0), Facet::I, ALIGN_NONE, FD_REG_DS);
     StackPush(AddrIPRel()); // return address
-    SetIP(new_rip);
+    // Keep direct targets constant, so that they can be called directly.
+    if (new_rip)
+        SetIP(new_rip);
+    else
+        SetIP(inst.end() + inst.op(0).pcrel());
 
     if (cfg.call_function) {
         CallExternalFunction(cfg.call_function);
@@ -747,6 +961,7 @@ Lifter::RepInfo Lifter::RepBegin(const Instr& inst) {
     if (info.mode != RepInfo::NO_REP) {
         info.header_block = irb.GetInsertBlock();
         info.loop_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+        info.latch_block = info.loop_block;
         info.cont_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
 
         if (condrep) {
@@ -801,20 +1016,20 @@ void Lifter::RepEnd(RepInfo info, llvm::Value* cmpA, llvm::Value* cmpB) {
     // First update pointer registers with direction flag
     if (info.loop_di) {
         llvm::Value* adjDi = irb.CreateGEP(info.ty, info.loop_di, info.adj);
-        info.loop_di->addIncoming(adjDi, info.loop_block);
-        info.cont_di->addIncoming(adjDi, info.loop_block);
+        info.loop_di->addIncoming(adjDi, info.latch_block);
+        info.cont_di->addIncoming(adjDi, info.latch_block);
     }
     if (info.loop_si) {
         llvm::Value* adjSi = irb.CreateGEP(info.ty, info.loop_si, info.adj);
-        info.loop_si->addIncoming(adjSi, info.loop_block);
-        info.cont_si->addIncoming(adjSi, info.loop_block);
+        info.loop_si->addIncoming(adjSi, info.latch_block);
+        info.cont_si->addIncoming(adjSi, info.latch_block);
     }
 
     // Decrement count and check.
     llvm::Value* count = info.loop_count;
     count = irb.CreateSub(count, irb.getInt64(1));
-    info.loop_count->addIncoming(count, info.loop_block);
-    info.cont_count->addIncoming(count, info.loop_block);
+    info.loop_count->addIncoming(count, info.latch_block);
+    info.cont_count->addIncoming(count, info.latch_block);
 
     llvm::Value* zero = llvm::Constant::getNullValue(count->getType());
     llvm::Value* cond = irb.CreateICmpNE(count, zero);
@@ -870,9 +1085,9 @@ void Lifter::LiftLods(const Instr& inst) {
 }
 
 void Lifter::LiftStos(const Instr& inst) {
-    if (inst.has_rep() && inst.opsz() == 1) {
-        // TODO: respect address size
-        // TODO: support stosw/stosd/stosq if rax == 0
+    // memset/memmove operate on 64-bit addresses; with a 32-bit address size,
+    // edi wraps around, so use the element-wise loop instead.
+    if (inst.has_rep() && inst.opsz() == 1 && inst.addrsz() == 8) {
         llvm::Type* ty = irb.getIntNTy(inst.opsz() * 8);
         auto di = GetReg(ArchReg::RDI, Facet::PTR);
         auto cx = GetReg(ArchReg::RCX, Facet::I64);
@@ -904,8 +1119,11 @@ void Lifter::LiftStos(const Instr& inst) {
         return;
     }
 
-    // TODO: optimize REP STOSB and other sizes with constant zero to llvm
-    // memset intrinsic.
+    if (inst.has_rep() && inst.addrsz() == 8) {
+        LiftRepMovsStos(inst);
+        return;
+    }
+
     auto ax = GetReg(ArchReg::RAX, Facet::In(inst.opsz() * 8));
 
     RepInfo rep_info = RepBegin(inst); // NOTE: this modifies control flow!
@@ -914,22 +1132,163 @@ void Lifter::LiftStos(const Instr& inst) {
 }
 
 void Lifter::LiftMovs(const Instr& inst) {
-    // TODO: optimize REP MOVSB to use llvm memcpy intrinsic.
+    if (inst.has_rep() && inst.addrsz() == 8) {
+        LiftRepMovsStos(inst);
+        return;
+    }
+
     RepInfo rep_info = RepBegin(inst); // NOTE: this modifies control flow!
     irb.CreateStore(irb.CreateLoad(rep_info.ty, rep_info.si), rep_info.di);
     RepEnd(rep_info); // NOTE: this modifies control flow!
 }
 
+void Lifter::LiftRepMovsStos(const Instr& inst) {
+    assert(inst.addrsz() == 8 && "memmove/memset need 64-bit addresses");
+    bool movs = inst.type() == FDI_MOVS;
+    llvm::Type* ty = irb.getIntNTy(inst.opsz() * 8);
+    llvm::Value* di = GetReg(ArchReg::RDI, Facet::PTR);
+    llvm::Value* si = movs ? GetReg(ArchReg::RSI, Facet::PTR) : nullptr;
+    llvm::Value* ax = movs ? nullptr : GetReg(ArchReg::RAX, Facet::In(inst.opsz() * 8));
+    llvm::Value* cx = GetReg(ArchReg::RCX, Facet::I64);
+    llvm::Value* bytes = irb.CreateMul(cx, irb.getInt64(inst.opsz()));
+
+    // Handle the entire count with memmove/memset if the direction is forward
+    // and the result is the same as for element-wise operation; otherwise,
+    // fall back to the loop.
+    llvm::Value* fast = irb.CreateNot(GetFlag(ArchReg::DF));
+    llvm::Value* fill = nullptr;
+    if (movs) {
+        // Copying element-wise repeats the source if the destination starts
+        // inside it.
+        llvm::Value* di_int = irb.CreatePtrToInt(di, irb.getInt64Ty());
+        llvm::Value* si_int = irb.CreatePtrToInt(si, irb.getInt64Ty());
+        llvm::Value* dist = irb.CreateSub(di_int, si_int);
+        llvm::Value* overlap = irb.CreateAnd(irb.CreateICmpUGT(di_int, si_int),
+                                             irb.CreateICmpULT(dist, bytes));
+        fast = irb.CreateAnd(fast, irb.CreateNot(overlap));
+    } else {
+        // memset needs all bytes of the value to be equal.
+        fill = irb.CreateTrunc(ax, irb.getInt8Ty());
+        if (inst.opsz() > 1) {
+            auto ones = llvm::APInt::getSplat(inst.opsz() * 8, llvm::APInt(8, 1));
+            llvm::Value* splat = irb.CreateMul(irb.CreateZExt(fill, ty),
+                                               llvm::ConstantInt::get(ty, ones));
+            fast = irb.CreateAnd(fast, irb.CreateICmpEQ(ax, splat));
+        }
+    }
+
+    auto* fast_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    auto* loop_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    auto* cont_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    irb.CreateCondBr(fast, fast_block, loop_block);
+
+    SetInsertBlock(fast_block);
+    if (movs)
+        irb.CreateMemMove(di, llvm::Align(), si, llvm::Align(), bytes);
+    else
+        irb.CreateMemSet(di, fill, bytes, llvm::Align());
+    llvm::Value* fast_di = irb.CreateGEP(irb.getInt8Ty(), di, bytes);
+    llvm::Value* fast_si = movs ? irb.CreateGEP(irb.getInt8Ty(), si, bytes) : nullptr;
+    irb.CreateBr(cont_block);
+
+    // The loop doesn't modify the register file until RepEnd.
+    SetInsertBlock(loop_block);
+    RepInfo rep_info = RepBegin(inst); // NOTE: this modifies control flow!
+    if (movs)
+        irb.CreateStore(irb.CreateLoad(ty, rep_info.si), rep_info.di);
+    else
+        irb.CreateStore(ax, rep_info.di);
+    RepEnd(rep_info); // NOTE: this modifies control flow!
+    llvm::Value* loop_di = GetReg(ArchReg::RDI, Facet::PTR);
+    llvm::Value* loop_si = movs ? GetReg(ArchReg::RSI, Facet::PTR) : nullptr;
+    llvm::BasicBlock* loop_end = irb.GetInsertBlock();
+    irb.CreateBr(cont_block);
+
+    SetInsertBlock(cont_block);
+    llvm::PHINode* di_phi = irb.CreatePHI(di->getType(), 2);
+    di_phi->addIncoming(fast_di, fast_block);
+    di_phi->addIncoming(loop_di, loop_end);
+    SetReg(ArchReg::RDI, di_phi);
+    if (movs) {
+        llvm::PHINode* si_phi = irb.CreatePHI(si->getType(), 2);
+        si_phi->addIncoming(fast_si, fast_block);
+        si_phi->addIncoming(loop_si, loop_end);
+        SetReg(ArchReg::RSI, si_phi);
+    }
+    SetReg(ArchReg::RCX, irb.getInt64(0));
+}
+
+void Lifter::RepSkipChunks(const Instr& inst, RepInfo& info, llvm::Value* src) {
+    // Compare 16 bytes at once while the direction is forward, more than one
+    // chunk of elements is left, and no chunk crosses a page. Chunks that
+    // contain the terminating element are processed element-wise, so the
+    // resulting registers and flags are exactly those of the plain loop.
+    // With a 32-bit address size, edi/esi wrap around, so only the plain loop
+    // is used.
+    if (info.mode != RepInfo::REPZ && info.mode != RepInfo::REPNZ)
+        return;
+    if (inst.addrsz() != 8)
+        return;
+
+    unsigned elems = 16 / (info.ty->getIntegerBitWidth() / 8);
+    llvm::Type* vec_ty = llvm::VectorType::get(info.ty, elems, false);
+    auto page_ok = [&] (llvm::Value* ptr) {
+        llvm::Value* off = irb.CreatePtrToInt(ptr, irb.getInt64Ty());
+        off = irb.CreateAnd(off, irb.getInt64(0xfff));
+        return irb.CreateICmpULE(off, irb.getInt64(0x1000 - 16));
+    };
+
+    llvm::Value* fwd = irb.CreateICmpEQ(info.adj, irb.getInt64(1));
+    llvm::Value* cond = irb.CreateICmpUGT(info.loop_count, irb.getInt64(elems));
+    cond = irb.CreateAnd(irb.CreateAnd(fwd, cond), page_ok(info.loop_di));
+    if (info.loop_si)
+        cond = irb.CreateAnd(cond, page_ok(info.loop_si));
+
+    auto* chunk_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    auto* elem_block = llvm::BasicBlock::Create(irb.getContext(), "", fi.fn);
+    irb.CreateCondBr(cond, chunk_block, elem_block);
+
+    SetInsertBlock(chunk_block);
+    llvm::Value* lhs;
+    if (info.loop_si)
+        lhs = irb.CreateAlignedLoad(vec_ty, info.loop_si, llvm::Align(1));
+    else
+        lhs = irb.CreateVectorSplat(elems, src);
+    llvm::Value* rhs = irb.CreateAlignedLoad(vec_ty, info.loop_di, llvm::Align(1));
+    llvm::Value* stop;
+    if (info.mode == RepInfo::REPZ)
+        stop = irb.CreateICmpNE(lhs, rhs);
+    else
+        stop = irb.CreateICmpEQ(lhs, rhs);
+    stop = irb.CreateBitCast(stop, irb.getIntNTy(elems));
+    stop = irb.CreateICmpNE(stop, irb.getIntN(elems, 0));
+
+    llvm::Value* step = irb.getInt64(elems);
+    info.loop_di->addIncoming(irb.CreateGEP(info.ty, info.loop_di, step), chunk_block);
+    if (info.loop_si)
+        info.loop_si->addIncoming(irb.CreateGEP(info.ty, info.loop_si, step), chunk_block);
+    info.loop_count->addIncoming(irb.CreateSub(info.loop_count, step), chunk_block);
+    irb.CreateCondBr(stop, elem_block, info.loop_block);
+
+    // The element-wise step starts from the unmodified loop values.
+    SetInsertBlock(elem_block);
+    info.di = info.loop_di;
+    info.si = info.loop_si;
+    info.latch_block = elem_block;
+}
+
 void Lifter::LiftScas(const Instr& inst) {
     auto src = GetReg(ArchReg::RAX, Facet::In(inst.opsz() * 8));
 
     RepInfo rep_info = RepBegin(inst); // NOTE: this modifies control flow!
+    RepSkipChunks(inst, rep_info, src);
     llvm::Value* dst = irb.CreateLoad(rep_info.ty, rep_info.di);
     RepEnd(rep_info, src, dst); // NOTE: this modifies control flow!
 }
 
 void Lifter::LiftCmps(const Instr& inst) {
     RepInfo rep_info = RepBegin(inst); // NOTE: this modifies control flow!
+    RepSkipChunks(inst, rep_info, nullptr);
     llvm::Value* src = irb.CreateLoad(rep_info.ty, rep_info.si);
     llvm::Value* dst = irb.CreateLoad(rep_info.ty, rep_info.di);
     RepEnd(rep_info, src, dst); // NOTE: this modifies control flow!
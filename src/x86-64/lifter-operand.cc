@@ -167,6 +167,8 @@ llvm::Value* Lifter::OpLoad(const Instr::Op op, Facet facet,
     } else if (op.is_mem()) {
         llvm::Type* type = facet.Type(irb.getContext());
         llvm::Value* addr = OpAddr(op, type, seg);
+        if (llvm::Constant* ro_val = LoadReadOnly(type, addr))
+            return ro_val;
         llvm::LoadInst* result = irb.CreateLoad(type, addr);
         // FIXME: forward SSE information to increase alignment.
         ll_operand_set_alignment(result, type, alignment, false);
@@ -225,6 +227,19 @@ void Lifter::OpStoreVec(const Instr::Op op, llvm::Value* value,
     }
 }
 
+void Lifter::OpStoreVex(const Instr::Op op, llvm::Value* value,
+                        Alignment alignment) {
+    if (op.is_mem()) {
+        llvm::Value* addr = OpAddr(op, value->getType());
+        llvm::StoreInst* store = irb.CreateStore(value, addr);
+        ll_operand_set_alignment(store, value->getType(), alignment, true);
+    } else {
+        assert(op.is_reg() && "vex-store to non-mem/non-reg");
+        // VEX-encoded instructions clear the register above the result.
+        SetReg(MapReg(op.reg()), value);
+    }
+}
+
 void Lifter::StackPush(llvm::Value* value) {
     llvm::Value* rsp = GetReg(ArchReg::RSP, Facet::PTR);
     rsp = irb.CreateConstGEP1_64(value->getType(), rsp, -1);
@@ -85,11 +85,17 @@ private:
     llvm::Value* OpLoad(const Instr::Op op, Facet facet, Alignment alignment = ALIGN_NONE, unsigned force_seg = 7);
     void OpStoreGp(const Instr::Op op, llvm::Value* value, Alignment alignment = ALIGN_NONE);
     void OpStoreVec(const Instr::Op op, llvm::Value* value, Alignment alignment = ALIGN_IMP);
+    void OpStoreVex(const Instr::Op op, llvm::Value* value, Alignment alignment = ALIGN_NONE);
     void StackPush(llvm::Value* value);
     llvm::Value* StackPop(const ArchReg sp_src_reg = ArchReg::RSP);
 
+    /// Whether the current instruction's write to the flag is never read.
+    bool FlagDead(ArchReg flag) {
+        return fi.dead_flags & (1u << flag.Index());
+    }
     void FlagCalcZ(llvm::Value* value) {
-        regfile->Set(ArchReg::ZF, RegFile::Transform::IsZero, value);
+        if (!FlagDead(ArchReg::ZF))
+            regfile->Set(ArchReg::ZF, RegFile::Transform::IsZero, value);
     }
     // Set SF and PF according to result, AF is undefined.
     void FlagCalcSAPLogic(llvm::Value* res);
@@ -107,6 +113,7 @@ private:
         RepMode mode;
         llvm::BasicBlock* header_block;
         llvm::BasicBlock* loop_block;
+        llvm::BasicBlock* latch_block;
         llvm::BasicBlock* cont_block;
 
         llvm::Type* ty;
@@ -125,12 +132,13 @@ private:
             llvm::PHINode* phi = llvm::PHINode::Create(oldVal->getType(), 2);
             phi->insertInto(cont_block, cont_block->begin());
             phi->addIncoming(oldVal, header_block);
-            phi->addIncoming(loopVal, loop_block);
+            phi->addIncoming(loopVal, latch_block);
             return phi;
         }
         // uint64_t ip;
     };
     RepInfo RepBegin(const Instr& inst);
+    void RepSkipChunks(const Instr& inst, RepInfo& info, llvm::Value* src);
     void RepEnd(RepInfo info, llvm::Value* cmpA = nullptr, llvm::Value* cmpB = nullptr);
 
     void LiftMovgp(const Instr&);
@@ -156,6 +164,16 @@ private:
     void LiftCsep(const Instr& inst);
     void LiftBitscan(const Instr& inst, bool trailing);
     void LiftPopcnt(const Instr& inst);
+    void LiftLzTzcnt(const Instr& inst, bool trailing);
+    void LiftAndn(const Instr& inst);
+    void LiftBextr(const Instr& inst);
+    void LiftBls(const Instr& inst);
+    void LiftBzhi(const Instr& inst);
+    void LiftShiftx(const Instr& inst, llvm::Instruction::BinaryOps op);
+    void LiftRorx(const Instr& inst);
+    void LiftMulx(const Instr& inst);
+    void LiftPdepPext(const Instr& inst, bool deposit);
+    void LiftAdcxAdox(const Instr& inst, ArchReg flag);
     void LiftBittest(const Instr& inst, llvm::Instruction::BinaryOps op,
                      llvm::AtomicRMWInst::BinOp atomic_op);
     void LiftMovbe(const Instr& inst);
@@ -191,6 +209,7 @@ private:
     void LiftLods(const Instr& inst);
     void LiftStos(const Instr& inst);
     void LiftMovs(const Instr& inst);
+    void LiftRepMovsStos(const Instr& inst);
     void LiftScas(const Instr& inst);
     void LiftCmps(const Instr& inst);
 
@@ -246,6 +265,50 @@ private:
     void LiftSsePsign(const Instr&, Facet);
     void LiftSseMovmsk(const Instr&, Facet op_type);
     void LiftSsePmovx(const Instr&, llvm::Instruction::CastOps ext, Facet from, Facet to);
+
+    // lifter-avx.cc
+    llvm::Value* AvxScalarMerge(const Instr&, llvm::Value* scalar);
+    llvm::Value* AvxShift(llvm::Instruction::BinaryOps op, llvm::Value* src, llvm::Value* shift);
+    void LiftAvxZeroupper(const Instr&);
+    void LiftAvxMov(const Instr&, Facet, Alignment);
+    void LiftAvxMovq(const Instr&, Facet type);
+    void LiftAvxMovScalar(const Instr&, Facet);
+    void LiftAvxBinOp(const Instr&, llvm::Instruction::BinaryOps op, Facet op_type);
+    void LiftAvxAndn(const Instr&, Facet op_type);
+    void LiftAvxMinmax(const Instr&, llvm::CmpInst::Predicate, Facet);
+    void LiftAvxSqrt(const Instr&, Facet op_type);
+    void LiftAvxCmp(const Instr&, Facet op_type);
+    void LiftAvxCvt(const Instr&, Facet src_type, Facet dst_type);
+    void LiftAvxPcmp(const Instr&, llvm::CmpInst::Predicate, Facet);
+    void LiftAvxPminmax(const Instr&, llvm::CmpInst::Predicate, Facet);
+    void LiftAvxPabs(const Instr&, Facet);
+    void LiftAvxPmuldq(const Instr&, llvm::Instruction::CastOps ext);
+    void LiftAvxPshiftElement(const Instr&, llvm::Instruction::BinaryOps op, Facet op_type);
+    void LiftAvxPshiftVar(const Instr&, llvm::Instruction::BinaryOps op, Facet op_type);
+    void LiftAvxUnpck(const Instr&, Facet op_type, bool high);
+    void LiftAvxPshufd(const Instr&);
+    void LiftAvxShufps(const Instr&);
+    void LiftAvxShufpd(const Instr&);
+    void LiftAvxPshufb(const Instr&);
+    void LiftAvxPmovx(const Instr&, llvm::Instruction::CastOps ext, Facet from, Facet to);
+    void LiftAvxPtest(const Instr&);
+    void LiftAvxBroadcast(const Instr&, Facet type);
+    void LiftAvxInsert128(const Instr&);
+    void LiftAvxExtract128(const Instr&);
+    void LiftAvxPerm2128(const Instr&);
+    void LiftAvxPermq(const Instr&, Facet op_type);
+    void LiftAvxBlend(const Instr&, Facet op_type);
+    void LiftAvxBlendv(const Instr&, Facet op_type);
+
+    // lifter-crypto.cc
+    llvm::Value* AesSubBytes(llvm::Value* state, bool inverse);
+    llvm::Value* AesShiftRows(llvm::Value* state, bool inverse);
+    llvm::Value* AesMixColumns(llvm::Value* state, bool inverse);
+    void LiftCrc32(const Instr&);
+    void LiftPclmulqdq(const Instr&, bool vex);
+    void LiftAes(const Instr&, bool decrypt, bool last, bool vex);
+    void LiftAesimc(const Instr&, bool vex);
+    void LiftAeskeygenassist(const Instr&, bool vex);
 };
 
 } // namespace::x86_64
@@ -84,7 +84,8 @@ void Lifter::LiftFxrstor(const Instr& inst) {
 
     for (unsigned i = 0; i < 16; i++) {
         llvm::Value* ptr = irb.CreateConstGEP1_32(i8, buf, 0xa0 + 0x10 * i);
-        SetReg(ArchReg::VEC(i), irb.CreateLoad(ivec_ty, ptr));
+        // FXRSTOR leaves the upper halves of the ymm registers unmodified.
+        regfile->Merge(ArchReg::VEC(i), irb.CreateLoad(ivec_ty, ptr));
     }
 }
 
@@ -95,7 +95,6 @@ bool Lifter::Lift(const Instr& inst) {
     case FDI_SYSCALL: LiftSyscall(inst); break;
     case FDI_CPUID: LiftCpuid(inst); break;
     case FDI_RDTSC: LiftRdtsc(inst); break;
-    // case FDI_CRC32: NOT IMPLEMENTED
     // case FDI_UD2: Intentionally not implemented.
 
     case FDI_LAHF: StoreGpFacet(ArchReg::RAX, Facet::I8H, FlagAsReg(8)); break;
@@ -138,10 +137,25 @@ bool Lifter::Lift(const Instr& inst) {
     case FDI_SHLD: LiftShiftdouble(inst); break;
     case FDI_SHRD: LiftShiftdouble(inst); break;
     case FDI_BSF: LiftBitscan(inst, /*trailing=*/true); break;
-    case FDI_TZCNT: LiftBitscan(inst, /*trailing=*/true); break; // TODO: support TZCNT
+    case FDI_TZCNT: LiftLzTzcnt(inst, /*trailing=*/true); break;
     case FDI_BSR: LiftBitscan(inst, /*trailing=*/false); break;
-    case FDI_LZCNT: LiftBitscan(inst, /*trailing=*/false); break; // TODO: support LZCNT
+    case FDI_LZCNT: LiftLzTzcnt(inst, /*trailing=*/false); break;
     case FDI_POPCNT: LiftPopcnt(inst); break;
+    case FDI_ANDN: LiftAndn(inst); break;
+    case FDI_BEXTR: LiftBextr(inst); break;
+    case FDI_BLSI: LiftBls(inst); break;
+    case FDI_BLSMSK: LiftBls(inst); break;
+    case FDI_BLSR: LiftBls(inst); break;
+    case FDI_BZHI: LiftBzhi(inst); break;
+    case FDI_SHLX: LiftShiftx(inst, llvm::Instruction::Shl); break;
+    case FDI_SHRX: LiftShiftx(inst, llvm::Instruction::LShr); break;
+    case FDI_SARX: LiftShiftx(inst, llvm::Instruction::AShr); break;
+    case FDI_RORX: LiftRorx(inst); break;
+    case FDI_MULX: LiftMulx(inst); break;
+    case FDI_PDEP: LiftPdepPext(inst, /*deposit=*/true); break;
+    case FDI_PEXT: LiftPdepPext(inst, /*deposit=*/false); break;
+    case FDI_ADCX: LiftAdcxAdox(inst, ArchReg::CF); break;
+    case FDI_ADOX: LiftAdcxAdox(inst, ArchReg::OF); break;
     case FDI_BT: LiftBittest(inst, llvm::Instruction::Or, llvm::AtomicRMWInst::Or); break;
     case FDI_BTC: LiftBittest(inst, llvm::Instruction::Xor, llvm::AtomicRMWInst::Xor); break;
     case FDI_BTR: LiftBittest(inst, llvm::Instruction::And, llvm::AtomicRMWInst::And); break;
@@ -430,6 +444,206 @@ bool Lifter::Lift(const Instr& inst) {
     case FDI_SSE_PMOVZXWQ: LiftSsePmovx(inst, llvm::Instruction::ZExt, Facet::V2I16, Facet::V2I64); break;
     case FDI_SSE_PMOVZXDQ: LiftSsePmovx(inst, llvm::Instruction::ZExt, Facet::V2I32, Facet::V2I64); break;
 
+    // Defined in lifter-avx.cc
+    case FDI_VZEROUPPER: LiftAvxZeroupper(inst); break;
+    case FDI_VZEROALL: LiftAvxZeroupper(inst); break;
+    case FDI_VMOVD: LiftAvxMovq(inst, Facet::I32); break;
+    case FDI_VMOVQ: LiftAvxMovq(inst, Facet::I64); break;
+    case FDI_VMOVSS: LiftAvxMovScalar(inst, Facet::I32); break;
+    case FDI_VMOVSD: LiftAvxMovScalar(inst, Facet::I64); break;
+    case FDI_VMOVUPS: LiftAvxMov(inst, Facet::VF32, ALIGN_NONE); break;
+    case FDI_VMOVUPD: LiftAvxMov(inst, Facet::VF64, ALIGN_NONE); break;
+    case FDI_VMOVAPS: LiftAvxMov(inst, Facet::VF32, ALIGN_MAX); break;
+    case FDI_VMOVAPD: LiftAvxMov(inst, Facet::VF64, ALIGN_MAX); break;
+    case FDI_VMOVDQU: LiftAvxMov(inst, Facet::VI64, ALIGN_NONE); break;
+    case FDI_VMOVDQA: LiftAvxMov(inst, Facet::VI64, ALIGN_MAX); break;
+    case FDI_VLDDQU: LiftAvxMov(inst, Facet::VI64, ALIGN_NONE); break;
+    case FDI_VMOVNTPS: LiftAvxMov(inst, Facet::VF32, ALIGN_MAX); break;
+    case FDI_VMOVNTPD: LiftAvxMov(inst, Facet::VF64, ALIGN_MAX); break;
+    case FDI_VMOVNTDQ: LiftAvxMov(inst, Facet::VI64, ALIGN_MAX); break;
+    case FDI_VMOVNTDQA: LiftAvxMov(inst, Facet::VI64, ALIGN_MAX); break;
+    case FDI_VADDSS: LiftAvxBinOp(inst, llvm::Instruction::FAdd, Facet::F32); break;
+    case FDI_VADDSD: LiftAvxBinOp(inst, llvm::Instruction::FAdd, Facet::F64); break;
+    case FDI_VADDPS: LiftAvxBinOp(inst, llvm::Instruction::FAdd, Facet::VF32); break;
+    case FDI_VADDPD: LiftAvxBinOp(inst, llvm::Instruction::FAdd, Facet::VF64); break;
+    case FDI_VSUBSS: LiftAvxBinOp(inst, llvm::Instruction::FSub, Facet::F32); break;
+    case FDI_VSUBSD: LiftAvxBinOp(inst, llvm::Instruction::FSub, Facet::F64); break;
+    case FDI_VSUBPS: LiftAvxBinOp(inst, llvm::Instruction::FSub, Facet::VF32); break;
+    case FDI_VSUBPD: LiftAvxBinOp(inst, llvm::Instruction::FSub, Facet::VF64); break;
+    case FDI_VMULSS: LiftAvxBinOp(inst, llvm::Instruction::FMul, Facet::F32); break;
+    case FDI_VMULSD: LiftAvxBinOp(inst, llvm::Instruction::FMul, Facet::F64); break;
+    case FDI_VMULPS: LiftAvxBinOp(inst, llvm::Instruction::FMul, Facet::VF32); break;
+    case FDI_VMULPD: LiftAvxBinOp(inst, llvm::Instruction::FMul, Facet::VF64); break;
+    case FDI_VDIVSS: LiftAvxBinOp(inst, llvm::Instruction::FDiv, Facet::F32); break;
+    case FDI_VDIVSD: LiftAvxBinOp(inst, llvm::Instruction::FDiv, Facet::F64); break;
+    case FDI_VDIVPS: LiftAvxBinOp(inst, llvm::Instruction::FDiv, Facet::VF32); break;
+    case FDI_VDIVPD: LiftAvxBinOp(inst, llvm::Instruction::FDiv, Facet::VF64); break;
+    case FDI_VMINSS: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OLT, Facet::F32); break;
+    case FDI_VMINSD: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OLT, Facet::F64); break;
+    case FDI_VMINPS: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OLT, Facet::VF32); break;
+    case FDI_VMINPD: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OLT, Facet::VF64); break;
+    case FDI_VMAXSS: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OGT, Facet::F32); break;
+    case FDI_VMAXSD: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OGT, Facet::F64); break;
+    case FDI_VMAXPS: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OGT, Facet::VF32); break;
+    case FDI_VMAXPD: LiftAvxMinmax(inst, llvm::CmpInst::FCMP_OGT, Facet::VF64); break;
+    case FDI_VSQRTSS: LiftAvxSqrt(inst, Facet::F32); break;
+    case FDI_VSQRTSD: LiftAvxSqrt(inst, Facet::F64); break;
+    case FDI_VSQRTPS: LiftAvxSqrt(inst, Facet::VF32); break;
+    case FDI_VSQRTPD: LiftAvxSqrt(inst, Facet::VF64); break;
+    case FDI_VANDPS: LiftAvxBinOp(inst, llvm::Instruction::And, Facet::VI32); break;
+    case FDI_VANDPD: LiftAvxBinOp(inst, llvm::Instruction::And, Facet::VI64); break;
+    case FDI_VANDNPS: LiftAvxAndn(inst, Facet::VI32); break;
+    case FDI_VANDNPD: LiftAvxAndn(inst, Facet::VI64); break;
+    case FDI_VORPS: LiftAvxBinOp(inst, llvm::Instruction::Or, Facet::VI32); break;
+    case FDI_VORPD: LiftAvxBinOp(inst, llvm::Instruction::Or, Facet::VI64); break;
+    case FDI_VXORPS: LiftAvxBinOp(inst, llvm::Instruction::Xor, Facet::VI32); break;
+    case FDI_VXORPD: LiftAvxBinOp(inst, llvm::Instruction::Xor, Facet::VI64); break;
+    case FDI_VCOMISS: LiftSseComis(inst, Facet::F32); break;
+    case FDI_VCOMISD: LiftSseComis(inst, Facet::F64); break;
+    case FDI_VUCOMISS: LiftSseComis(inst, Facet::F32); break;
+    case FDI_VUCOMISD: LiftSseComis(inst, Facet::F64); break;
+    case FDI_VCMPSS: LiftAvxCmp(inst, Facet::F32); break;
+    case FDI_VCMPSD: LiftAvxCmp(inst, Facet::F64); break;
+    case FDI_VCMPPS: LiftAvxCmp(inst, Facet::VF32); break;
+    case FDI_VCMPPD: LiftAvxCmp(inst, Facet::VF64); break;
+    case FDI_VCVTDQ2PS: LiftAvxCvt(inst, Facet::VI32, Facet::VF32); break;
+    case FDI_VCVTDQ2PD: LiftAvxCvt(inst, Facet::VI32, Facet::VF64); break;
+    case FDI_VCVTTPS2DQ: LiftAvxCvt(inst, Facet::VF32, Facet::VI32); break;
+    case FDI_VCVTTPD2DQ: LiftAvxCvt(inst, Facet::VF64, Facet::VI32); break;
+    case FDI_VCVTPS2PD: LiftAvxCvt(inst, Facet::VF32, Facet::VF64); break;
+    case FDI_VCVTPD2PS: LiftAvxCvt(inst, Facet::VF64, Facet::VF32); break;
+    case FDI_VCVTTSS2SI: LiftSseCvt(inst, Facet::F32, Facet::I); break;
+    case FDI_VCVTTSD2SI: LiftSseCvt(inst, Facet::F64, Facet::I); break;
+    case FDI_VPADDB: LiftAvxBinOp(inst, llvm::Instruction::Add, Facet::VI8); break;
+    case FDI_VPADDW: LiftAvxBinOp(inst, llvm::Instruction::Add, Facet::VI16); break;
+    case FDI_VPADDD: LiftAvxBinOp(inst, llvm::Instruction::Add, Facet::VI32); break;
+    case FDI_VPADDQ: LiftAvxBinOp(inst, llvm::Instruction::Add, Facet::VI64); break;
+    case FDI_VPSUBB: LiftAvxBinOp(inst, llvm::Instruction::Sub, Facet::VI8); break;
+    case FDI_VPSUBW: LiftAvxBinOp(inst, llvm::Instruction::Sub, Facet::VI16); break;
+    case FDI_VPSUBD: LiftAvxBinOp(inst, llvm::Instruction::Sub, Facet::VI32); break;
+    case FDI_VPSUBQ: LiftAvxBinOp(inst, llvm::Instruction::Sub, Facet::VI64); break;
+    case FDI_VPMULLW: LiftAvxBinOp(inst, llvm::Instruction::Mul, Facet::VI16); break;
+    case FDI_VPMULLD: LiftAvxBinOp(inst, llvm::Instruction::Mul, Facet::VI32); break;
+    case FDI_VPMULDQ: LiftAvxPmuldq(inst, llvm::Instruction::SExt); break;
+    case FDI_VPMULUDQ: LiftAvxPmuldq(inst, llvm::Instruction::ZExt); break;
+    case FDI_VPAND: LiftAvxBinOp(inst, llvm::Instruction::And, Facet::VI64); break;
+    case FDI_VPANDN: LiftAvxAndn(inst, Facet::VI64); break;
+    case FDI_VPOR: LiftAvxBinOp(inst, llvm::Instruction::Or, Facet::VI64); break;
+    case FDI_VPXOR: LiftAvxBinOp(inst, llvm::Instruction::Xor, Facet::VI64); break;
+    case FDI_VPCMPEQB: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_EQ, Facet::VI8); break;
+    case FDI_VPCMPEQW: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_EQ, Facet::VI16); break;
+    case FDI_VPCMPEQD: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_EQ, Facet::VI32); break;
+    case FDI_VPCMPEQQ: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_EQ, Facet::VI64); break;
+    case FDI_VPCMPGTB: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_SGT, Facet::VI8); break;
+    case FDI_VPCMPGTW: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_SGT, Facet::VI16); break;
+    case FDI_VPCMPGTD: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_SGT, Facet::VI32); break;
+    case FDI_VPCMPGTQ: LiftAvxPcmp(inst, llvm::CmpInst::ICMP_SGT, Facet::VI64); break;
+    case FDI_VPMINUB: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_ULT, Facet::VI8); break;
+    case FDI_VPMINUW: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_ULT, Facet::VI16); break;
+    case FDI_VPMINUD: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_ULT, Facet::VI32); break;
+    case FDI_VPMINSB: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_SLT, Facet::VI8); break;
+    case FDI_VPMINSW: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_SLT, Facet::VI16); break;
+    case FDI_VPMINSD: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_SLT, Facet::VI32); break;
+    case FDI_VPMAXUB: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_UGT, Facet::VI8); break;
+    case FDI_VPMAXUW: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_UGT, Facet::VI16); break;
+    case FDI_VPMAXUD: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_UGT, Facet::VI32); break;
+    case FDI_VPMAXSB: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_SGT, Facet::VI8); break;
+    case FDI_VPMAXSW: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_SGT, Facet::VI16); break;
+    case FDI_VPMAXSD: LiftAvxPminmax(inst, llvm::CmpInst::ICMP_SGT, Facet::VI32); break;
+    case FDI_VPABSB: LiftAvxPabs(inst, Facet::VI8); break;
+    case FDI_VPABSW: LiftAvxPabs(inst, Facet::VI16); break;
+    case FDI_VPABSD: LiftAvxPabs(inst, Facet::VI32); break;
+    case FDI_VPSLLW: LiftAvxPshiftElement(inst, llvm::Instruction::Shl, Facet::VI16); break;
+    case FDI_VPSLLD: LiftAvxPshiftElement(inst, llvm::Instruction::Shl, Facet::VI32); break;
+    case FDI_VPSLLQ: LiftAvxPshiftElement(inst, llvm::Instruction::Shl, Facet::VI64); break;
+    case FDI_VPSRLW: LiftAvxPshiftElement(inst, llvm::Instruction::LShr, Facet::VI16); break;
+    case FDI_VPSRLD: LiftAvxPshiftElement(inst, llvm::Instruction::LShr, Facet::VI32); break;
+    case FDI_VPSRLQ: LiftAvxPshiftElement(inst, llvm::Instruction::LShr, Facet::VI64); break;
+    case FDI_VPSRAW: LiftAvxPshiftElement(inst, llvm::Instruction::AShr, Facet::VI16); break;
+    case FDI_VPSRAD: LiftAvxPshiftElement(inst, llvm::Instruction::AShr, Facet::VI32); break;
+    case FDI_VPSLLVD: LiftAvxPshiftVar(inst, llvm::Instruction::Shl, Facet::VI32); break;
+    case FDI_VPSLLVQ: LiftAvxPshiftVar(inst, llvm::Instruction::Shl, Facet::VI64); break;
+    case FDI_VPSRLVD: LiftAvxPshiftVar(inst, llvm::Instruction::LShr, Facet::VI32); break;
+    case FDI_VPSRLVQ: LiftAvxPshiftVar(inst, llvm::Instruction::LShr, Facet::VI64); break;
+    case FDI_VPSRAVD: LiftAvxPshiftVar(inst, llvm::Instruction::AShr, Facet::VI32); break;
+    case FDI_VPUNPCKLBW: LiftAvxUnpck(inst, Facet::VI8, false); break;
+    case FDI_VPUNPCKLWD: LiftAvxUnpck(inst, Facet::VI16, false); break;
+    case FDI_VPUNPCKLDQ: LiftAvxUnpck(inst, Facet::VI32, false); break;
+    case FDI_VPUNPCKLQDQ: LiftAvxUnpck(inst, Facet::VI64, false); break;
+    case FDI_VPUNPCKHBW: LiftAvxUnpck(inst, Facet::VI8, true); break;
+    case FDI_VPUNPCKHWD: LiftAvxUnpck(inst, Facet::VI16, true); break;
+    case FDI_VPUNPCKHDQ: LiftAvxUnpck(inst, Facet::VI32, true); break;
+    case FDI_VPUNPCKHQDQ: LiftAvxUnpck(inst, Facet::VI64, true); break;
+    case FDI_VUNPCKLPS: LiftAvxUnpck(inst, Facet::VF32, false); break;
+    case FDI_VUNPCKLPD: LiftAvxUnpck(inst, Facet::VF64, false); break;
+    case FDI_VUNPCKHPS: LiftAvxUnpck(inst, Facet::VF32, true); break;
+    case FDI_VUNPCKHPD: LiftAvxUnpck(inst, Facet::VF64, true); break;
+    case FDI_VPSHUFD: LiftAvxPshufd(inst); break;
+    case FDI_VSHUFPS: LiftAvxShufps(inst); break;
+    case FDI_VSHUFPD: LiftAvxShufpd(inst); break;
+    case FDI_VPSHUFB: LiftAvxPshufb(inst); break;
+    case FDI_VPERMQ: LiftAvxPermq(inst, Facet::V4I64); break;
+    case FDI_VPERMPD: LiftAvxPermq(inst, Facet::V4F64); break;
+    case FDI_VPEXTRB: LiftSsePextr(inst, Facet::VI8, 0x0f); break;
+    case FDI_VPEXTRW: LiftSsePextr(inst, Facet::VI16, 0x07); break;
+    case FDI_VPEXTRD: LiftSsePextr(inst, Facet::VI32, 0x03); break;
+    case FDI_VPEXTRQ: LiftSsePextr(inst, Facet::VI64, 0x01); break;
+    case FDI_VEXTRACTPS: LiftSsePextr(inst, Facet::VF32, 0x03); break;
+    case FDI_VPMOVMSKB: LiftSseMovmsk(inst, Facet::VI8); break;
+    case FDI_VMOVMSKPS: LiftSseMovmsk(inst, Facet::VI32); break;
+    case FDI_VMOVMSKPD: LiftSseMovmsk(inst, Facet::VI64); break;
+    case FDI_VPMOVSXBW: LiftAvxPmovx(inst, llvm::Instruction::SExt, Facet::I8, Facet::I16); break;
+    case FDI_VPMOVSXBD: LiftAvxPmovx(inst, llvm::Instruction::SExt, Facet::I8, Facet::I32); break;
+    case FDI_VPMOVSXBQ: LiftAvxPmovx(inst, llvm::Instruction::SExt, Facet::I8, Facet::I64); break;
+    case FDI_VPMOVSXWD: LiftAvxPmovx(inst, llvm::Instruction::SExt, Facet::I16, Facet::I32); break;
+    case FDI_VPMOVSXWQ: LiftAvxPmovx(inst, llvm::Instruction::SExt, Facet::I16, Facet::I64); break;
+    case FDI_VPMOVSXDQ: LiftAvxPmovx(inst, llvm::Instruction::SExt, Facet::I32, Facet::I64); break;
+    case FDI_VPMOVZXBW: LiftAvxPmovx(inst, llvm::Instruction::ZExt, Facet::I8, Facet::I16); break;
+    case FDI_VPMOVZXBD: LiftAvxPmovx(inst, llvm::Instruction::ZExt, Facet::I8, Facet::I32); break;
+    case FDI_VPMOVZXBQ: LiftAvxPmovx(inst, llvm::Instruction::ZExt, Facet::I8, Facet::I64); break;
+    case FDI_VPMOVZXWD: LiftAvxPmovx(inst, llvm::Instruction::ZExt, Facet::I16, Facet::I32); break;
+    case FDI_VPMOVZXWQ: LiftAvxPmovx(inst, llvm::Instruction::ZExt, Facet::I16, Facet::I64); break;
+    case FDI_VPMOVZXDQ: LiftAvxPmovx(inst, llvm::Instruction::ZExt, Facet::I32, Facet::I64); break;
+    case FDI_VPBROADCASTB: LiftAvxBroadcast(inst, Facet::I8); break;
+    case FDI_VPBROADCASTW: LiftAvxBroadcast(inst, Facet::I16); break;
+    case FDI_VPBROADCASTD: LiftAvxBroadcast(inst, Facet::I32); break;
+    case FDI_VPBROADCASTQ: LiftAvxBroadcast(inst, Facet::I64); break;
+    case FDI_VBROADCASTSS: LiftAvxBroadcast(inst, Facet::F32); break;
+    case FDI_VBROADCASTSD: LiftAvxBroadcast(inst, Facet::F64); break;
+    case FDI_VBROADCASTF128: LiftAvxBroadcast(inst, Facet::V2I64); break;
+    case FDI_VBROADCASTI128: LiftAvxBroadcast(inst, Facet::V2I64); break;
+    case FDI_VINSERTF128: LiftAvxInsert128(inst); break;
+    case FDI_VINSERTI128: LiftAvxInsert128(inst); break;
+    case FDI_VEXTRACTF128: LiftAvxExtract128(inst); break;
+    case FDI_VEXTRACTI128: LiftAvxExtract128(inst); break;
+    case FDI_VPERM2F128: LiftAvxPerm2128(inst); break;
+    case FDI_VPERM2I128: LiftAvxPerm2128(inst); break;
+    case FDI_VBLENDPS: LiftAvxBlend(inst, Facet::VI32); break;
+    case FDI_VBLENDPD: LiftAvxBlend(inst, Facet::VI64); break;
+    case FDI_VPBLENDW: LiftAvxBlend(inst, Facet::VI16); break;
+    case FDI_VPBLENDD: LiftAvxBlend(inst, Facet::VI32); break;
+    case FDI_VBLENDVPS: LiftAvxBlendv(inst, Facet::VI32); break;
+    case FDI_VBLENDVPD: LiftAvxBlendv(inst, Facet::VI64); break;
+    case FDI_VPBLENDVB: LiftAvxBlendv(inst, Facet::VI8); break;
+    case FDI_VPTEST: LiftAvxPtest(inst); break;
+
+    // Defined in lifter-crypto.cc
+    case FDI_CRC32: LiftCrc32(inst); break;
+    case FDI_SSE_PCLMULQDQ: LiftPclmulqdq(inst, /*vex=*/false); break;
+    case FDI_VPCLMULQDQ: LiftPclmulqdq(inst, /*vex=*/true); break;
+    case FDI_SSE_AESENC: LiftAes(inst, /*decrypt=*/false, /*last=*/false, /*vex=*/false); break;
+    case FDI_SSE_AESENCLAST: LiftAes(inst, /*decrypt=*/false, /*last=*/true, /*vex=*/false); break;
+    case FDI_SSE_AESDEC: LiftAes(inst, /*decrypt=*/true, /*last=*/false, /*vex=*/false); break;
+    case FDI_SSE_AESDECLAST: LiftAes(inst, /*decrypt=*/true, /*last=*/true, /*vex=*/false); break;
+    case FDI_SSE_AESIMC: LiftAesimc(inst, /*vex=*/false); break;
+    case FDI_SSE_AESKEYGENASSIST: LiftAeskeygenassist(inst, /*vex=*/false); break;
+    case FDI_VAESENC: LiftAes(inst, /*decrypt=*/false, /*last=*/false, /*vex=*/true); break;
+    case FDI_VAESENCLAST: LiftAes(inst, /*decrypt=*/false, /*last=*/true, /*vex=*/true); break;
+    case FDI_VAESDEC: LiftAes(inst, /*decrypt=*/true, /*last=*/false, /*vex=*/true); break;
+    case FDI_VAESDECLAST: LiftAes(inst, /*decrypt=*/true, /*last=*/true, /*vex=*/true); break;
+    case FDI_VAESIMC: LiftAesimc(inst, /*vex=*/true); break;
+    case FDI_VAESKEYGENASSIST: LiftAeskeygenassist(inst, /*vex=*/true); break;
+
     // Jumps are handled in the basic block generation code.
     case FDI_JMP: LiftJmp(inst); break;
     case FDI_JO: LiftJcc(inst, Condition::O); break;
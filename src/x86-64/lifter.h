@@ -24,6 +24,8 @@
 #ifndef RELLUME_LIFTER_H
 #define RELLUME_LIFTER_H
 
+#include <utility>
+
 namespace rellume {
 
 class ArchBasicBlock;
@@ -36,6 +38,11 @@ namespace x86_64 {
 bool LiftInstruction(const Instr& inst, FunctionInfo& fi, const LLConfig& cfg,
                      ArchBasicBlock& ab) noexcept;
 
+/// Status flags read and written by an instruction, as bit masks indexed by
+/// flag register index. Instructions unknown to the summary read all flags.
+std::pair<unsigned, unsigned> InstrFlagEffects(const Instr& inst,
+                                               const LLConfig& cfg) noexcept;
+
 } // namespace rellume::x86_64
 
 } // namespace rellume
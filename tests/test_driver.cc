@@ -3,10 +3,16 @@
 
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/GenericValue.h>
+#include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/TargetSelect.h>
+#if LL_LLVM_MAJOR < 17
+#include <llvm/Support/Host.h>
+#else
+#include <llvm/TargetParser/Host.h>
+#endif
 
 #include <cstddef>
 #include <cstdio>
@@ -32,6 +38,10 @@ static bool opt_verbose = false;
 static bool opt_jit = false;
 static bool opt_pic = false;
 static bool opt_overflow_intrinsics = false;
+static bool opt_regcc = false;
+static bool opt_promote = false;
+static bool opt_native_bmi2 = false;
+static bool opt_native_crypto = false;
 static const char* opt_arch = "x86_64";
 
 struct HexBuffer {
@@ -213,6 +223,87 @@ class TestCase {
         return std::make_pair(key_str, value_str);
     }
 
+    // Parse an option value of the form <hex>:<hex>.
+    std::pair<uint64_t, uint64_t> split_hex_pair(std::string value_str) {
+        size_t sep_off = value_str.find(':');
+        if (sep_off == std::string::npos) {
+            std::cerr << "invalid input: " << value_str << std::endl;
+            std::exit(1);
+        }
+        uint64_t first = std::stoull(value_str.substr(0, sep_off), nullptr, 16);
+        uint64_t second = std::stoull(value_str.substr(sep_off + 1), nullptr, 16);
+        return std::make_pair(first, second);
+    }
+
+    // Create a function with a CPU struct pointer as only parameter, which
+    // passes PC and registers to fn, which uses the register-passing calling
+    // convention, and stores the returned values back.
+    llvm::Function* WrapRegCallConv(llvm::Function* fn) {
+        std::vector<std::string> reg_names;
+        if (!strcmp(opt_arch, "x86_64")) {
+            reg_names = {"rip", "rax", "rcx", "rdx", "rbx", "rsp", "rbp",
+                         "rsi", "rdi", "r8", "r9", "r10", "r11"};
+        } else if (!strcmp(opt_arch, "aarch64")) {
+            reg_names = {"pc", "x0", "x1", "x2", "x3", "x4", "x5"};
+        }
+
+        llvm::LLVMContext& ctx = fn->getContext();
+        llvm::Type* sptr_ty = fn->getFunctionType()->getParamType(0);
+        auto wrapper_ty = llvm::FunctionType::get(llvm::Type::getVoidTy(ctx),
+                                                  {sptr_ty}, false);
+        auto wrapper = llvm::Function::Create(wrapper_ty,
+                                              llvm::GlobalValue::ExternalLinkage,
+                                              "", fn->getParent());
+        llvm::IRBuilder<> irb(llvm::BasicBlock::Create(ctx, "", wrapper));
+        llvm::Value* sptr = wrapper->arg_begin();
+
+        llvm::SmallVector<llvm::Value*, 16> reg_ptrs;
+        llvm::SmallVector<llvm::Value*, 16> args{sptr};
+        for (const auto& name : reg_names) {
+            off_t offset = regs->at(name).offset;
+            reg_ptrs.push_back(irb.CreateConstGEP1_64(irb.getInt8Ty(), sptr, offset));
+            args.push_back(irb.CreateLoad(irb.getInt64Ty(), reg_ptrs.back()));
+        }
+        llvm::CallInst* call = irb.CreateCall(fn->getFunctionType(), fn, args);
+        call->setCallingConv(fn->getCallingConv());
+        for (unsigned i = 0; i < reg_ptrs.size(); i++)
+            irb.CreateStore(irb.CreateExtractValue(call, {i}), reg_ptrs[i]);
+        irb.CreateRetVoid();
+        return wrapper;
+    }
+
+    // Create a function for ll_config_set_call_func, which returns to the
+    // caller and overwrites all other general purpose registers.
+    llvm::Function* CreateCallFunction(llvm::Module* mod) {
+        static const char* const clobbered_regs[] = {
+            "rax", "rcx", "rdx", "rbx", "rbp", "rsi", "rdi", "r8",
+            "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+        };
+
+        llvm::LLVMContext& ctx = mod->getContext();
+        llvm::Type* ptr_ty = llvm::PointerType::get(ctx, 0);
+        auto fn_ty = llvm::FunctionType::get(llvm::Type::getVoidTy(ctx),
+                                             {ptr_ty}, false);
+        auto fn = llvm::Function::Create(fn_ty, llvm::GlobalValue::ExternalLinkage,
+                                         "call_function", mod);
+        llvm::IRBuilder<> irb(llvm::BasicBlock::Create(ctx, "", fn));
+        llvm::Value* sptr = fn->arg_begin();
+        auto reg_ptr = [&](const char* name) {
+            off_t offset = regs->at(name).offset;
+            return irb.CreateConstGEP1_64(irb.getInt8Ty(), sptr, offset);
+        };
+
+        llvm::Value* rsp = irb.CreateLoad(irb.getInt64Ty(), reg_ptr("rsp"));
+        llvm::Value* ret_addr_ptr = irb.CreateIntToPtr(rsp, ptr_ty);
+        llvm::Value* ret_addr = irb.CreateLoad(irb.getInt64Ty(), ret_addr_ptr);
+        irb.CreateStore(ret_addr, reg_ptr("rip"));
+        irb.CreateStore(irb.CreateAdd(rsp, irb.getInt64(8)), reg_ptr("rsp"));
+        for (const char* name : clobbered_regs)
+            irb.CreateStore(irb.getInt64(0xdeadbeefdeadbeef), reg_ptr(name));
+        irb.CreateRetVoid();
+        return fn;
+    }
+
     template<typename T>
     void Randomize(T& t) {
         using bytes_randomizer = std::independent_bits_engine<std::mt19937, CHAR_BIT, uint8_t>;
@@ -231,6 +322,20 @@ class TestCase {
         bool should_pass = true;
         bool use_jit = opt_jit;
         bool use_pic = opt_pic;
+        bool use_regcc = opt_regcc;
+        bool use_promote = opt_promote;
+        bool use_call_function = false;
+        bool call_preserve_callee_saved = false;
+        // Read-only ranges, loads from these are folded at lift time.
+        std::vector<std::pair<uint64_t, uint64_t>> ro_ranges;
+        // Entry of a function lifted separately and called directly.
+        uint64_t callee_addr = 0;
+        // Pairs of branch and target address for ll_func_decode_more.
+        std::vector<std::pair<uint64_t, uint64_t>> more_entries;
+        size_t max_instrs = 0;
+        size_t max_blocks = 0;
+        uint64_t max_span = 0;
+        bool expect_partial = false;
 
         // 1. Setup initial state
         CPU initial{};
@@ -247,6 +352,32 @@ class TestCase {
                 use_pic = true;
             } else if (arg == "-pic") {
                 use_pic = false;
+            } else if (arg == "+regcc") {
+                use_regcc = true;
+            } else if (arg == "-regcc") {
+                use_regcc = false;
+            } else if (arg == "+promote") {
+                use_promote = true;
+            } else if (arg == "-promote") {
+                use_promote = false;
+            } else if (arg == "+callfn") {
+                use_call_function = true;
+            } else if (arg == "+callpreserve") {
+                call_preserve_callee_saved = true;
+            } else if (arg.substr(0, 7) == "+romem=") {
+                ro_ranges.push_back(split_hex_pair(arg.substr(7)));
+            } else if (arg.substr(0, 8) == "+callee=") {
+                callee_addr = std::stoull(arg.substr(8), nullptr, 16);
+            } else if (arg.substr(0, 6) == "+more=") {
+                more_entries.push_back(split_hex_pair(arg.substr(6)));
+            } else if (arg.substr(0, 12) == "+max_instrs=") {
+                max_instrs = std::stoull(arg.substr(12));
+            } else if (arg.substr(0, 12) == "+max_blocks=") {
+                max_blocks = std::stoull(arg.substr(12));
+            } else if (arg.substr(0, 10) == "+max_span=") {
+                max_span = std::stoull(arg.substr(10));
+            } else if (arg == "+partial") {
+                expect_partial = true;
             } else if (arg.substr(0, 1) == "~") {
                 continue;
             } else if (arg == "=>") {
@@ -279,15 +410,65 @@ class TestCase {
         ll_config_enable_verify_ir(rlcfg, true);
         ll_config_set_position_independent_code(rlcfg, use_pic);
         ll_config_enable_overflow_intrinsics(rlcfg, opt_overflow_intrinsics);
+        ll_config_enable_stack_promotion(rlcfg, use_promote);
+        ll_config_set_use_native_bmi2(rlcfg, opt_native_bmi2);
+        ll_config_set_use_native_crypto(rlcfg, opt_native_crypto);
+        ll_config_set_decode_budget(rlcfg, max_instrs, max_blocks, max_span);
+        ll_config_set_call_preserve_callee_saved(rlcfg, call_preserve_callee_saved);
+        for (const auto& [start, end] : ro_ranges)
+            ll_config_add_ro_range(rlcfg, start, end);
         bool success = ll_config_set_architecture(rlcfg, opt_arch);
         if (!success) {
             diagnostic << "# error: unsupported architecture" << std::endl;
             return true;
         }
+        if (!ll_config_set_register_callconv(rlcfg, use_regcc)) {
+            diagnostic << "# error: unsupported calling convention" << std::endl;
+            return true;
+        }
+        if (use_call_function) {
+            if (strcmp(opt_arch, "x86_64")) {
+                diagnostic << "# error: +callfn requires x86_64" << std::endl;
+                return true;
+            }
+            llvm::Function* call_fn = CreateCallFunction(mod.get());
+            ll_config_set_call_func(rlcfg, llvm::wrap(call_fn));
+        }
+        if (callee_addr) {
+            // The callee uses a different calling convention than the caller.
+            LLConfig* callee_cfg = ll_config_new();
+            ll_config_enable_verify_ir(callee_cfg, true);
+            ll_config_set_architecture(callee_cfg, opt_arch);
+            bool callee_ok = ll_config_set_register_callconv(callee_cfg, !use_regcc);
+            LLFunc* callee = ll_func_new(llvm::wrap(mod.get()), callee_cfg);
+            callee_ok = callee_ok && !ll_func_decode_cfg(callee, callee_addr, nullptr, nullptr);
+            LLVMValueRef callee_fn = callee_ok ? ll_func_lift(callee) : nullptr;
+            ll_func_dispose(callee);
+            ll_config_free(callee_cfg);
+            if (!callee_fn) {
+                diagnostic << "# error: could not lift callee" << std::endl;
+                return true;
+            }
+            ll_config_set_lifted_func(rlcfg, callee_addr, callee_fn);
+        }
 
         LLFunc* rlfn = ll_func_new(llvm::wrap(mod.get()), rlcfg);
         bool decode_ok = !ll_func_decode_cfg(rlfn, *reinterpret_cast<uint64_t*>(&state.rip), nullptr, nullptr);
         LLVMValueRef fn_wrap = decode_ok ? ll_func_lift(rlfn) : nullptr;
+        // Add further code to the lifted function and lift it again; only the
+        // last function is executed.
+        for (const auto& [branch, target] : more_entries) {
+            if (!fn_wrap)
+                break;
+            llvm::unwrap<llvm::Function>(fn_wrap)->eraseFromParent();
+            fn_wrap = nullptr;
+            if (ll_func_decode_more(rlfn, branch, target, nullptr, nullptr) < 0) {
+                diagnostic << "# error: could not decode more" << std::endl;
+                break;
+            }
+            fn_wrap = ll_func_lift(rlfn);
+        }
+        bool partial = ll_func_is_partial(rlfn);
 
         ll_func_dispose(rlfn);
         ll_config_free(rlcfg);
@@ -300,9 +481,13 @@ class TestCase {
             diagnostic << "# error during lifting" << std::endl;
             return should_pass;
         }
+        if (partial != expect_partial) {
+            diagnostic << "# error: function " << (partial ? "is" : "is not")
+                       << " partial" << std::endl;
+            fail = true;
+        }
 
         llvm::Function* fn = llvm::unwrap<llvm::Function>(fn_wrap);
-        fn->setName("test_function");
         if (opt_verbose)
             fn->print(llvm::errs());
 
@@ -310,6 +495,11 @@ class TestCase {
             diagnostic << "# error: IR verification failed\n";
             return true;
         }
+        if (use_regcc) {
+            fn->setName("lifted_function");
+            fn = WrapRegCallConv(fn);
+        }
+        fn->setName("test_function");
 
         std::string error;
 
@@ -331,6 +521,9 @@ class TestCase {
         builder.setOptLevel(llvm::CodeGenOptLevel::None);
 #endif
         builder.setTargetOptions(options);
+        // Native intrinsics require the features of the host.
+        if (opt_native_bmi2 || opt_native_crypto)
+            builder.setMCPU(llvm::sys::getHostCPUName());
 
         if (llvm::ExecutionEngine* engine = builder.create()) {
             // If we have a JIT compiler, get address of compiled code.
@@ -395,16 +588,20 @@ public:
 
 int main(int argc, char** argv) {
     int opt;
-    while ((opt = getopt(argc, argv, "vjpiA:")) != -1) {
+    while ((opt = getopt(argc, argv, "vjpirsbcA:")) != -1) {
         switch (opt) {
         case 'v': opt_verbose = true; break;
         case 'j': opt_jit = true; break;
         case 'p': opt_pic = true; break;
         case 'i': opt_overflow_intrinsics = true; break;
+        case 'r': opt_regcc = true; break;
+        case 's': opt_promote = true; break;
+        case 'b': opt_native_bmi2 = true; break;
+        case 'c': opt_native_crypto = true; break;
         case 'A': opt_arch = optarg; break;
         default:
 usage:
-            std::cerr << "usage: " << argv[0] << " [-v] [-j] [-p] [-i] [-A arch] casefile" << std::endl;
+            std::cerr << "usage: " << argv[0] << " [-v] [-j] [-p] [-i] [-r] [-s] [-b] [-c] [-A arch] casefile" << std::endl;
             return 1;
         }
     }
@@ -412,6 +609,33 @@ usage:
     if (optind >= argc)
         goto usage;
 
+    // Native intrinsics cannot be interpreted and need a capable host.
+    bool host_supported = true;
+    if (opt_native_bmi2) {
+        opt_jit = true;
+#if defined(__x86_64__)
+        host_supported &= __builtin_cpu_supports("bmi2");
+#else
+        host_supported = false;
+#endif
+    }
+    if (opt_native_crypto) {
+        opt_jit = true;
+#if defined(__x86_64__)
+        // VAESENC and VPCLMULQDQ with xmm operands also need AVX.
+        host_supported &= __builtin_cpu_supports("sse4.2") &&
+                          __builtin_cpu_supports("aes") &&
+                          __builtin_cpu_supports("pclmul") &&
+                          __builtin_cpu_supports("avx");
+#else
+        host_supported = false;
+#endif
+    }
+    if (!host_supported) {
+        std::cout << "1..0 # SKIP host lacks native instructions" << std::endl;
+        return 0;
+    }
+
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
 